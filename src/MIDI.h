@@ -31,6 +31,22 @@
 #include "midi_Platform.h"
 #include "midi_Settings.h"
 #include "midi_Message.h"
+#include "midi_PackedMessage.h"
+#include "midi_SysExPool.h"
+#include "midi_Parser.h"
+#include "midi_Callbacks.h"
+#include "midi_AtomicCallbacks.h"
+#include "midi_EventBlock.h"
+#include "midi_Profiler.h"
+#include "midi_FeatureState.h"
+#include "midi_InputCore.h"
+#include "midi_Transport.h"
+#include "midi_TxQueue.h"
+#include "midi_OutputCache.h"
+#include "midi_PacedSysEx.h"
+#include "midi_Scheduler.h"
+#include "midi_Events.h"
+#include "midi_Coroutine.h"
 
 #include "serialMIDI.h"
 
@@ -48,14 +64,35 @@ It is templated over the type of serial port to provide abstraction from
 the hardware interface, meaning you can use HardwareSerial, SoftwareSerial
 or ak47's Uart classes. The only requirement is that the class implements
 the begin, read, write and available methods.
+Received messages are dispatched to the Handler, which defaults to calling
+the functions registered with the setHandle******** methods.
+@see EmptyHandler to dispatch to static hooks instead.
+Parsing and dispatch are done by the InputCore base, shared by the interfaces
+using different transports.
+State of the optional features is held in base classes, which are empty when
+the feature is disabled in the Settings, so that it takes no RAM.
  */
-template<class Transport, class _Settings = DefaultSettings, class _Platform = DefaultPlatform>
+template<class Transport, class _Settings = DefaultSettings, class _Platform = DefaultPlatform, class _Handler = CallbackHandler<_Settings> >
 class MidiInterface
+    : private InputCore<_Settings, _Platform, _Handler>
+    , private SenderActiveSensingState<_Platform, _Settings::UseSenderActiveSensing>
+    , private RunningStatusTxState<_Settings::UseRunningStatus,
+                                   _Platform,
+                                   _Settings::RunningStatusRefreshPeriod,
+                                   _Settings::RunningStatusRefreshCount>
+    , private TxQueue<_Settings::TxQueueSize, _Settings::RealTimeQueueSize>
+    , private OutputCache<_Settings::UseOutputCache>
+    , private PacedSysExState<_Platform, _Settings::UsePacedSysEx>
+    , private Scheduler<_Settings::ScheduleMaxSize>
+    , private TxChunk<_Settings::TxQueueSize == 0 && TransportAdapter::HasBulkWrite<Transport>::value>
 {
 public:
     typedef _Settings Settings;
     typedef _Platform Platform;
-    typedef Message<Settings::SysExMaxSize> MidiMessage;
+    typedef _Handler Handler;
+    typedef Message<Settings::SysExMaxSize, typename Settings::SysExPool> MidiMessage;
+    typedef Parser<Settings::SysExMaxSize, typename Settings::SysExPool> MidiParser;
+    typedef void (*ContextCallback)(void* context, const MidiMessage& message);
 
 public:
     inline  MidiInterface(Transport&);
@@ -99,6 +136,18 @@ public:
     inline MidiInterface& sendSysEx(unsigned inLength,
                           const byte* inArray,
                           bool inArrayContainsBoundaries = false);
+    inline MidiInterface& sendPacedSysEx(unsigned inLength,
+                               const byte* inArray,
+                               unsigned inChunkSize,
+                               unsigned long inChunkGap,
+                               bool inArrayContainsBoundaries = false);
+    inline bool isSendingPacedSysEx() const;
+    inline MidiInterface& sendEncodedSysEx(const byte* inHeader,
+                                 unsigned inHeaderLength,
+                                 const byte* inData,
+                                 unsigned inDataLength,
+                                 bool inFlipHeaderBits = false,
+                                 bool inAppendChecksum = false);
 
     inline MidiInterface& sendTimeCodeQuarterFrame(DataByte inTypeNibble,
                                          DataByte inValuesNibble);
@@ -147,6 +196,8 @@ public:
     inline MidiInterface& endNrpn(Channel inChannel);
 
     inline MidiInterface& send(const MidiMessage&);
+    inline MidiInterface& send(const MessageView&);
+    inline MidiInterface& send(PackedMessage);
 
 public:
     MidiInterface& send(MidiType inType,
@@ -154,6 +205,34 @@ public:
               DataByte inData2,
               Channel inChannel);
 
+public:
+    inline MidiInterface& beginBatch(unsigned inSizeHint = 0);
+    inline MidiInterface& commitBatch();
+
+public:
+    inline unsigned pump(unsigned inMaxBytes = ~0u);
+    inline void update();
+    inline bool isSendAccepted() const;
+    inline unsigned getTxQueueAvailable() const;
+
+public:
+    inline bool sendAt(unsigned long inTime, PackedMessage inMessage);
+    inline unsigned getScheduledCount() const;
+    inline MidiInterface& clearSchedule();
+
+public:
+    inline MidiInterface& invalidateOutputCache(Channel inChannel = MIDI_CHANNEL_OMNI);
+    inline MidiInterface& syncTo(const ChannelState& inState, Channel inChannel);
+    inline MidiInterface& syncTo(const ChannelState (&inStates)[16]);
+
+private:
+    inline bool beginTransmission(MidiType inType, unsigned inMaxLength);
+    inline void write(byte inByte);
+    inline void write(const byte* inData, unsigned inLength);
+    inline void endTransmission();
+    inline void updatePacedSysEx();
+    inline void updateSchedule();
+
     // -------------------------------------------------------------------------
     // MIDI Input
 
@@ -161,6 +240,11 @@ public:
     inline bool read();
     inline bool read(Channel inChannel);
 
+    template<class Visitor>
+    inline typename EnableIf<IsClass<Visitor>::value, bool>::type read(Visitor& inVisitor);
+    template<class Visitor>
+    inline bool read(Channel inChannel, Visitor& inVisitor);
+
 public:
     inline MidiType getType() const;
     inline Channel  getChannel() const;
@@ -170,6 +254,22 @@ public:
     inline unsigned getSysExArrayLength() const;
     inline bool check() const;
 
+#ifdef MIDI_HAS_COROUTINES
+public:
+    inline MessageAwaiter<MidiInterface> next(PollExecutor& inExecutor);
+
+private:
+    friend class MessageAwaiter<MidiInterface>;
+#endif
+
+public:
+    inline HandlerStats getHandlerStats(MidiType inType) const;
+    inline void resetHandlerStats();
+
+public:
+    inline EventBlock takeBlock(unsigned long inBlockStartTime,
+                                unsigned long inSampleRate);
+
 public:
     inline Channel getInputChannel() const;
     inline MidiInterface& setInputChannel(Channel inChannel);
@@ -183,54 +283,46 @@ public:
     // Input Callbacks
 
 public:
-    inline MidiInterface& setHandleMessage(void (*fptr)(const MidiMessage&)) { mMessageCallback = fptr; return *this; };
-    inline MidiInterface& setHandleError(ErrorCallback fptr) { mErrorCallback = fptr; return *this; };
-    inline MidiInterface& setHandleNoteOff(NoteOffCallback fptr) { mNoteOffCallback = fptr; return *this; };
-    inline MidiInterface& setHandleNoteOn(NoteOnCallback fptr) { mNoteOnCallback = fptr; return *this; };
-    inline MidiInterface& setHandleAfterTouchPoly(AfterTouchPolyCallback fptr) { mAfterTouchPolyCallback = fptr; return *this; };
-    inline MidiInterface& setHandleControlChange(ControlChangeCallback fptr) { mControlChangeCallback = fptr; return *this; };
-    inline MidiInterface& setHandleProgramChange(ProgramChangeCallback fptr) { mProgramChangeCallback = fptr; return *this; };
-    inline MidiInterface& setHandleAfterTouchChannel(AfterTouchChannelCallback fptr) { mAfterTouchChannelCallback = fptr; return *this; };
-    inline MidiInterface& setHandlePitchBend(PitchBendCallback fptr) { mPitchBendCallback = fptr; return *this; };
-    inline MidiInterface& setHandleSystemExclusive(SystemExclusiveCallback fptr) { mSystemExclusiveCallback = fptr; return *this; };
-    inline MidiInterface& setHandleTimeCodeQuarterFrame(TimeCodeQuarterFrameCallback fptr) { mTimeCodeQuarterFrameCallback = fptr; return *this; };
-    inline MidiInterface& setHandleSongPosition(SongPositionCallback fptr) { mSongPositionCallback = fptr; return *this; };
-    inline MidiInterface& setHandleSongSelect(SongSelectCallback fptr) { mSongSelectCallback = fptr; return *this; };
-    inline MidiInterface& setHandleTuneRequest(TuneRequestCallback fptr) { mTuneRequestCallback = fptr; return *this; };
-    inline MidiInterface& setHandleClock(ClockCallback fptr) { mClockCallback = fptr; return *this; };
-    inline MidiInterface& setHandleStart(StartCallback fptr) { mStartCallback = fptr; return *this; };
-    inline MidiInterface& setHandleTick(TickCallback fptr) { mTickCallback = fptr; return *this; };
-    inline MidiInterface& setHandleContinue(ContinueCallback fptr) { mContinueCallback = fptr; return *this; };
-    inline MidiInterface& setHandleStop(StopCallback fptr) { mStopCallback = fptr; return *this; };
-    inline MidiInterface& setHandleActiveSensing(ActiveSensingCallback fptr) { mActiveSensingCallback = fptr; return *this; };
-    inline MidiInterface& setHandleSystemReset(SystemResetCallback fptr) { mSystemResetCallback = fptr; return *this; };
-
+    inline MidiInterface& setHandleMessage(void (*fptr)(const MidiMessage&)) { mHandler.setHandleMessage(fptr); return *this; };
+    inline MidiInterface& setHandleMessage(ContextCallback fptr, void* inContext) { mHandler.setHandleMessage(fptr, inContext); return *this; };
+    inline MidiInterface& setHandleError(ErrorCallback fptr) { mHandler.setHandleError(fptr); return *this; };
+    inline MidiInterface& setHandleNoteOff(NoteOffCallback fptr) { mHandler.setHandleNoteOff(fptr); return *this; };
+    inline MidiInterface& setHandleNoteOn(NoteOnCallback fptr) { mHandler.setHandleNoteOn(fptr); return *this; };
+    inline MidiInterface& setHandleAfterTouchPoly(AfterTouchPolyCallback fptr) { mHandler.setHandleAfterTouchPoly(fptr); return *this; };
+    inline MidiInterface& setHandleControlChange(ControlChangeCallback fptr) { mHandler.setHandleControlChange(fptr); return *this; };
+    inline MidiInterface& setHandleProgramChange(ProgramChangeCallback fptr) { mHandler.setHandleProgramChange(fptr); return *this; };
+    inline MidiInterface& setHandleAfterTouchChannel(AfterTouchChannelCallback fptr) { mHandler.setHandleAfterTouchChannel(fptr); return *this; };
+    inline MidiInterface& setHandlePitchBend(PitchBendCallback fptr) { mHandler.setHandlePitchBend(fptr); return *this; };
+    inline MidiInterface& setHandleSystemExclusive(SystemExclusiveCallback fptr) { mHandler.setHandleSystemExclusive(fptr); return *this; };
+    inline MidiInterface& setHandleTimeCodeQuarterFrame(TimeCodeQuarterFrameCallback fptr) { mHandler.setHandleTimeCodeQuarterFrame(fptr); return *this; };
+    inline MidiInterface& setHandleSongPosition(SongPositionCallback fptr) { mHandler.setHandleSongPosition(fptr); return *this; };
+    inline MidiInterface& setHandleSongSelect(SongSelectCallback fptr) { mHandler.setHandleSongSelect(fptr); return *this; };
+    inline MidiInterface& setHandleTuneRequest(TuneRequestCallback fptr) { mHandler.setHandleTuneRequest(fptr); return *this; };
+    inline MidiInterface& setHandleClock(ClockCallback fptr) { mHandler.setHandleClock(fptr); return *this; };
+    inline MidiInterface& setHandleStart(StartCallback fptr) { mHandler.setHandleStart(fptr); return *this; };
+    inline MidiInterface& setHandleTick(TickCallback fptr) { mHandler.setHandleTick(fptr); return *this; };
+    inline MidiInterface& setHandleContinue(ContinueCallback fptr) { mHandler.setHandleContinue(fptr); return *this; };
+    inline MidiInterface& setHandleStop(StopCallback fptr) { mHandler.setHandleStop(fptr); return *this; };
+    inline MidiInterface& setHandleActiveSensing(ActiveSensingCallback fptr) { mHandler.setHandleActiveSensing(fptr); return *this; };
+    inline MidiInterface& setHandleSystemReset(SystemResetCallback fptr) { mHandler.setHandleSystemReset(fptr); return *this; };
+
+    inline MidiInterface& setHandleNoteOff(Channel inChannel, NoteOffCallback fptr) { mHandler.setHandleNoteOff(inChannel, fptr); return *this; };
+    inline MidiInterface& setHandleNoteOn(Channel inChannel, NoteOnCallback fptr) { mHandler.setHandleNoteOn(inChannel, fptr); return *this; };
+    inline MidiInterface& setHandleAfterTouchPoly(Channel inChannel, AfterTouchPolyCallback fptr) { mHandler.setHandleAfterTouchPoly(inChannel, fptr); return *this; };
+    inline MidiInterface& setHandleControlChange(Channel inChannel, ControlChangeCallback fptr) { mHandler.setHandleControlChange(inChannel, fptr); return *this; };
+    inline MidiInterface& setHandleProgramChange(Channel inChannel, ProgramChangeCallback fptr) { mHandler.setHandleProgramChange(inChannel, fptr); return *this; };
+    inline MidiInterface& setHandleAfterTouchChannel(Channel inChannel, AfterTouchChannelCallback fptr) { mHandler.setHandleAfterTouchChannel(inChannel, fptr); return *this; };
+    inline MidiInterface& setHandlePitchBend(Channel inChannel, PitchBendCallback fptr) { mHandler.setHandlePitchBend(inChannel, fptr); return *this; };
+
+    inline MidiInterface& setHandle(MidiType inType, ContextCallback fptr, void* inContext);
+    inline MidiInterface& setHandle(MidiType inType, Channel inChannel, ContextCallback fptr, void* inContext);
     inline MidiInterface& disconnectCallbackFromType(MidiType inType);
+    inline MidiInterface& disconnectCallbackFromType(MidiType inType, Channel inChannel);
+    inline bool hasChannelHandle(MidiType inType, Channel inChannel) const;
+
+public:
+    Handler* getHandler() { return &mHandler; };
 
-private:
-    void launchCallback();
-
-    void (*mMessageCallback)(const MidiMessage& message) = nullptr;
-    ErrorCallback mErrorCallback = nullptr;
-    NoteOffCallback mNoteOffCallback = nullptr;
-    NoteOnCallback mNoteOnCallback = nullptr;
-    AfterTouchPolyCallback mAfterTouchPolyCallback = nullptr;
-    ControlChangeCallback mControlChangeCallback = nullptr;
-    ProgramChangeCallback mProgramChangeCallback = nullptr;
-    AfterTouchChannelCallback mAfterTouchChannelCallback = nullptr;
-    PitchBendCallback mPitchBendCallback = nullptr;
-    SystemExclusiveCallback mSystemExclusiveCallback = nullptr;
-    TimeCodeQuarterFrameCallback mTimeCodeQuarterFrameCallback = nullptr;
-    SongPositionCallback mSongPositionCallback = nullptr;
-    SongSelectCallback mSongSelectCallback = nullptr;
-    TuneRequestCallback mTuneRequestCallback = nullptr;
-    ClockCallback mClockCallback = nullptr;
-    StartCallback mStartCallback = nullptr;
-    TickCallback mTickCallback = nullptr;
-    ContinueCallback mContinueCallback = nullptr;
-    StopCallback mStopCallback = nullptr;
-    ActiveSensingCallback mActiveSensingCallback = nullptr;
-    SystemResetCallback mSystemResetCallback = nullptr;
 
     // -------------------------------------------------------------------------
     // MIDI Soft Thru
@@ -251,9 +343,6 @@ private:
 
 private:
     bool parse();
-    inline void handleNullVelocityNoteOnAsNoteOff();
-    inline bool inputFilter(Channel inChannel);
-    inline void resetInput();
     inline void updateLastSentTime();
 
     // -------------------------------------------------------------------------
@@ -269,22 +358,27 @@ private:
     // Internal variables
 
 private:
-    Channel         mInputChannel;
-    StatusByte      mRunningStatus_RX;
-    StatusByte      mRunningStatus_TX;
-    byte            mPendingMessage[3];
-    unsigned        mPendingMessageExpectedLength;
-    unsigned        mPendingMessageIndex;
-    unsigned        mCurrentRpnNumber;
-    unsigned        mCurrentNrpnNumber;
+    typedef InputCore<Settings, Platform, Handler> Input;
+    typedef EventBlockQueue<Settings::EventBlockMaxSize> EventBlockStorage;
+    typedef HandlerProfiler<Platform, Settings::UseHandlerProfiler> Profiler;
+    typedef TxQueue<Settings::TxQueueSize, Settings::RealTimeQueueSize> TransmitQueue;
+    typedef OutputCache<Settings::UseOutputCache> LastSentValues;
+    typedef Scheduler<Settings::ScheduleMaxSize> Schedule;
+    typedef TxChunk<Settings::TxQueueSize == 0 && TransportAdapter::HasBulkWrite<Transport>::value> TransmitChunk;
+
+    using Input::mParser;
+    using Input::mMessage;
+    using Input::mInputChannel;
+    using Input::mLastError;
+    using Input::mHandler;
+
+    uint16_t        mCurrentRpnNumber;
+    uint16_t        mCurrentNrpnNumber;
     bool            mThruActivated  : 1;
     Thru::Mode      mThruFilterMode : 7;
-    MidiMessage     mMessage;
-    unsigned long   mLastMessageSentTime;
-    unsigned long   mLastMessageReceivedTime;
-    unsigned long   mSenderActiveSensingPeriodicity;
-    bool            mReceiverActiveSensingActivated;
-    int8_t          mLastError;
+    bool            mBatchActive    : 1;
+    bool            mBatchOpen      : 1;
+    uint16_t        mBatchSizeHint;
 
 private:
     inline StatusByte getStatus(MidiType inType,
@@ -30,33 +30,26 @@
 BEGIN_MIDI_NAMESPACE
 
 /// \brief Constructor for MidiInterface.
-template<class Transport, class Settings, class Platform>
-inline MidiInterface<Transport, Settings, Platform>::MidiInterface(Transport& inTransport)
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>::MidiInterface(Transport& inTransport)
     : mTransport(inTransport)
-    , mInputChannel(0)
-    , mRunningStatus_RX(InvalidType)
-    , mRunningStatus_TX(InvalidType)
-    , mPendingMessageExpectedLength(0)
-    , mPendingMessageIndex(0)
     , mCurrentRpnNumber(0xffff)
     , mCurrentNrpnNumber(0xffff)
     , mThruActivated(true)
     , mThruFilterMode(Thru::Full)
-    , mLastMessageSentTime(0)
-    , mLastMessageReceivedTime(0)
-    , mSenderActiveSensingPeriodicity(0)
-    , mReceiverActiveSensingActivated(false)
-    , mLastError(0)
+    , mBatchActive(false)
+    , mBatchOpen(false)
+    , mBatchSizeHint(0)
 {
-    mSenderActiveSensingPeriodicity = Settings::SenderActiveSensingPeriodicity;
+    this->setSenderActiveSensingPeriodicity(Settings::SenderActiveSensingPeriodicity);
 }
 
 /*! \brief Destructor for MidiInterface.
 
  This is not really useful for the Arduino, as it is never called...
  */
-template<class Transport, class Settings, class Platform>
-inline MidiInterface<Transport, Settings, Platform>::~MidiInterface()
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>::~MidiInterface()
 {
 }
 
@@ -68,23 +61,21 @@ inline MidiInterface<Transport, Settings, Platform>::~MidiInterface()
  - Input channel set to 1 if no value is specified
  - Full thru mirroring
  */
-template<class Transport, class Settings, class Platform>
-MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::begin(Channel inChannel)
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::begin(Channel inChannel)
 {
     // Initialise the Transport layer
     mTransport.begin();
 
     mInputChannel = inChannel;
-    mRunningStatus_TX = InvalidType;
-    mRunningStatus_RX = InvalidType;
-
-    mPendingMessageIndex = 0;
-    mPendingMessageExpectedLength = 0;
+    this->resetRunningStatusTx();
+    LastSentValues::clear(MIDI_CHANNEL_OMNI);
+    mParser.reset();
 
     mCurrentRpnNumber  = 0xffff;
     mCurrentNrpnNumber = 0xffff;
 
-    mLastMessageSentTime = Platform::now();
+    this->resetLastSentTime();
 
     mMessage.valid   = false;
     mMessage.type    = InvalidType;
@@ -115,42 +106,93 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
  This method does *not* check against any of the constraints.
  Typically this function is use by MIDI Bridges taking MIDI messages and passing
  them thru.
+ Channel messages still go through the output cache (see
+ Settings::UseOutputCache).
  */
-template<class Transport, class Settings, class Platform>
-MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::send(const MidiMessage& inMessage)
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::send(const MidiMessage& inMessage)
 {
     if (!inMessage.valid)
         return *this;
 
-    if (mTransport.beginTransmission(inMessage.type))
+    const bool cached = inMessage.isChannelMessage() &&
+                        inMessage.channel >= 1 && inMessage.channel <= 16;
+    if (cached && LastSentValues::isRedundant(inMessage.type, inMessage.data1, inMessage.data2, inMessage.channel))
+        return *this; // Nothing would change
+
+    const unsigned length = inMessage.type == SystemExclusive ? inMessage.getSysExSize() : 3;
+
+    if (beginTransmission(inMessage.type, length))
     {
         if (inMessage.isSystemRealTime())
         {
-            mTransport.write(inMessage.type);
+            write(inMessage.type);
         } else if (inMessage.isChannelMessage())
         {
             const StatusByte status = getStatus(inMessage.type, inMessage.channel);
-            mTransport.write(status);
-            if (inMessage.length > 1) mTransport.write(inMessage.data1);
-            if (inMessage.length > 2) mTransport.write(inMessage.data2);
+            write(status);
+            if (inMessage.length > 1) write(inMessage.data1);
+            if (inMessage.length > 2) write(inMessage.data2);
         } else if (inMessage.type == MidiType::SystemExclusive)
         {
-            const unsigned size = inMessage.getSysExSize();
-            for (size_t i = 0; i < size; i++)
-                mTransport.write(inMessage.sysexArray[i]);
+            write(inMessage.sysexArray, inMessage.getSysExSize());
         } else // at this point, it it assumed to be a system common message
         {
-            mTransport.write(inMessage.type);
-            if (inMessage.length > 1) mTransport.write(inMessage.data1);
-            if (inMessage.length > 2) mTransport.write(inMessage.data2);
+            write(inMessage.type);
+            if (inMessage.length > 1) write(inMessage.data1);
+            if (inMessage.length > 2) write(inMessage.data2);
         }
+        endTransmission();
+        updateLastSentTime();
+
+        if (cached)
+            LastSentValues::update(inMessage.type, inMessage.data1, inMessage.data2, inMessage.channel);
+        else if (inMessage.type == SystemReset)
+            LastSentValues::clear(MIDI_CHANNEL_OMNI);
     }
-    mTransport.endTransmission();
-    updateLastSentTime();
 
     return *this;
 }
 
+/*! \brief Send a message from a MessageView.
+ \param inMessage The view of the message to send, eg: of a message received
+ by another interface.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::send(const MessageView& inMessage)
+{
+    if (inMessage.type == SystemExclusive)
+        return sendSysEx(inMessage.sysexSize, inMessage.sysexArray, true);
+
+    if (inMessage.isSystemRealTime())
+        return sendRealTime(inMessage.type);
+
+    if (inMessage.isChannelMessage())
+        return send(inMessage.type, inMessage.data1, inMessage.data2, inMessage.channel);
+
+    // System Common
+    const unsigned data = (inMessage.type == SongPosition)
+                        ? unsigned(inMessage.data1 & 0x7f) | unsigned(inMessage.data2 & 0x7f) << 7
+                        : inMessage.data1;
+    return sendCommon(inMessage.type, data);
+}
+
+/*! \brief Send a packed message (see PackedMessage).
+ Invalid packed messages are ignored.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::send(PackedMessage inMessage)
+{
+    if (!inMessage.valid())
+        return *this;
+
+    MessageView view;
+    view.type    = inMessage.type();
+    view.channel = inMessage.channel();
+    view.data1   = inMessage.data1();
+    view.data2   = inMessage.data2();
+    return send(view);
+}
 
 /*! \brief Generate and send a MIDI message from the values given.
  \param inType    The message type (see type defines for reference)
@@ -163,8 +205,8 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
  This is an internal method, use it only if you need to send raw data
  from your code, at your own risks.
  */
-template<class Transport, class Settings, class Platform>
-MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::send(MidiType inType,
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::send(MidiType inType,
                                                DataByte inData1,
                                                DataByte inData2,
                                                Channel inChannel)
@@ -182,34 +224,34 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
         inData1 &= 0x7f;
         inData2 &= 0x7f;
 
+        if (Settings::SendNoteOffAsNullVelocityNoteOn && inType == NoteOff)
+        {
+            // Keeps the running status of NoteOn messages
+            inType  = NoteOn;
+            inData2 = 0;
+        }
+
+        if (LastSentValues::isRedundant(inType, inData1, inData2, inChannel))
+            return *this; // Nothing would change
+
         const StatusByte status = getStatus(inType, inChannel);
 
-        if (mTransport.beginTransmission(inType))
+        if (beginTransmission(inType, 3))
         {
-            if (Settings::UseRunningStatus)
-            {
-                if (mRunningStatus_TX != status)
-                {
-                    // New message, memorise and send header
-                    mRunningStatus_TX = status;
-                    mTransport.write(mRunningStatus_TX);
-                }
-            }
-            else
-            {
-                // Don't care about running status, send the status byte.
-                mTransport.write(status);
-            }
+            // Status byte is omitted when it matches the running status
+            if (this->updateRunningStatusTx(status))
+                write(status);
 
             // Then send data
-            mTransport.write(inData1);
+            write(inData1);
             if (inType != ProgramChange && inType != AfterTouchChannel)
             {
-                mTransport.write(inData2);
+                write(inData2);
             }
 
-            mTransport.endTransmission();
+            endTransmission();
             updateLastSentTime();
+            LastSentValues::update(inType, inData1, inData2, inChannel);
         }
     }
     else if (inType >= Clock && inType <= SystemReset)
@@ -231,8 +273,8 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
  Take a look at the values, names and frequencies of notes here:
  http://www.phys.unsw.edu.au/jw/notes.html
  */
-template<class Transport, class Settings, class Platform>
-MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendNoteOn(DataByte inNoteNumber,
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendNoteOn(DataByte inNoteNumber,
                                                      DataByte inVelocity,
                                                      Channel inChannel)
 {
@@ -246,12 +288,13 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
 
  Note: you can send NoteOn with zero velocity to make a NoteOff, this is based
  on the Running Status principle, to avoid sending status messages and thus
- sending only NoteOn data. sendNoteOff will always send a real NoteOff message.
+ sending only NoteOn data. sendNoteOff sends a real NoteOff message, unless
+ Settings::SendNoteOffAsNullVelocityNoteOn is set.
  Take a look at the values, names and frequencies of notes here:
  http://www.phys.unsw.edu.au/jw/notes.html
  */
-template<class Transport, class Settings, class Platform>
-MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendNoteOff(DataByte inNoteNumber,
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendNoteOff(DataByte inNoteNumber,
                                                       DataByte inVelocity,
                                                       Channel inChannel)
 {
@@ -262,8 +305,8 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
  \param inProgramNumber The Program to select (0 to 127).
  \param inChannel       The channel on which the message will be sent (1 to 16).
  */
-template<class Transport, class Settings, class Platform>
-MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendProgramChange(DataByte inProgramNumber,
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendProgramChange(DataByte inProgramNumber,
                                                             Channel inChannel)
 {
     return send(ProgramChange, inProgramNumber, 0, inChannel);
@@ -275,8 +318,8 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
  \param inChannel       The channel on which the message will be sent (1 to 16).
  @see MidiControlChangeNumber
  */
-template<class Transport, class Settings, class Platform>
-MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendControlChange(DataByte inControlNumber,
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendControlChange(DataByte inControlNumber,
                                                             DataByte inControlValue,
                                                             Channel inChannel)
 {
@@ -290,8 +333,8 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
  Note: this method is deprecated and will be removed in a future revision of the
  library, @see sendAfterTouch to send polyphonic and monophonic AfterTouch messages.
  */
-template<class Transport, class Settings, class Platform>
-MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendPolyPressure(DataByte inNoteNumber,
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendPolyPressure(DataByte inNoteNumber,
                                                            DataByte inPressure,
                                                            Channel inChannel)
 {
@@ -302,8 +345,8 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
  \param inPressure    The amount of AfterTouch to apply to all notes.
  \param inChannel     The channel on which the message will be sent (1 to 16).
  */
-template<class Transport, class Settings, class Platform>
-MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendAfterTouch(DataByte inPressure,
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendAfterTouch(DataByte inPressure,
                                                          Channel inChannel)
 {
     return send(AfterTouchChannel, inPressure, 0, inChannel);
@@ -315,8 +358,8 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
  \param inChannel     The channel on which the message will be sent (1 to 16).
  @see Replaces sendPolyPressure (which is now deprecated).
  */
-template<class Transport, class Settings, class Platform>
-MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendAfterTouch(DataByte inNoteNumber,
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendAfterTouch(DataByte inNoteNumber,
                                                          DataByte inPressure,
                                                          Channel inChannel)
 {
@@ -329,8 +372,8 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
  center value is 0.
  \param inChannel     The channel on which the message will be sent (1 to 16).
  */
-template<class Transport, class Settings, class Platform>
-MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendPitchBend(int inPitchValue,
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendPitchBend(int inPitchValue,
                                                         Channel inChannel)
 {
     const unsigned bend = unsigned(inPitchValue - int(MIDI_PITCHBEND_MIN));
@@ -344,8 +387,8 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
  and +1.0f (max upwards bend), center value is 0.0f.
  \param inChannel     The channel on which the message will be sent (1 to 16).
  */
-template<class Transport, class Settings, class Platform>
-MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendPitchBend(double inPitchValue,
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendPitchBend(double inPitchValue,
                                                         Channel inChannel)
 {
     const int scale = inPitchValue > 0.0 ? MIDI_PITCHBEND_MAX : - MIDI_PITCHBEND_MIN;
@@ -361,31 +404,142 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
  (and therefore must be included in the array).
  default value for ArrayContainsBoundaries is set to 'false' for compatibility
  with previous versions of the library.
+ With a transmit queue, a frame longer than the queue can hold is rejected
+ (see Settings::TxQueueSize).
  */
-template<class Transport, class Settings, class Platform>
-MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendSysEx(unsigned inLength,
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendSysEx(unsigned inLength,
                                                     const byte* inArray,
                                                     bool inArrayContainsBoundaries)
 {
     const bool writeBeginEndBytes = !inArrayContainsBoundaries;
 
-    if (mTransport.beginTransmission(MidiType::SystemExclusiveStart))
+    if (beginTransmission(MidiType::SystemExclusiveStart,
+                          writeBeginEndBytes ? inLength + 2 : inLength))
     {
         if (writeBeginEndBytes)
-            mTransport.write(MidiType::SystemExclusiveStart);
+            write(MidiType::SystemExclusiveStart);
 
-        for (unsigned i = 0; i < inLength; ++i)
-            mTransport.write(inArray[i]);
+        write(inArray, inLength);
 
         if (writeBeginEndBytes)
-            mTransport.write(MidiType::SystemExclusiveEnd);
+            write(MidiType::SystemExclusiveEnd);
 
-        mTransport.endTransmission();
+        endTransmission();
         updateLastSentTime();
    }
 
-    if (Settings::UseRunningStatus)
-        mRunningStatus_TX = InvalidType;
+    this->resetRunningStatusTx();
+
+    return *this;
+}
+
+/*! \brief Start sending a System Exclusive frame in chunks spaced in time.
+ \param inLength  The size of the array to send
+ \param inArray   The byte array containing the data to send, which must stay
+ valid until the whole frame has been sent.
+ \param inChunkSize The number of bytes sent at once (boundaries included).
+ \param inChunkGap The time to wait between chunks, in Platform::now() units
+ (milliseconds by default).
+ \param inArrayContainsBoundaries See sendSysEx.
+
+ The first chunk is sent right away, the next ones by read() or update() once
+ the gap has elapsed, so that input and Thru keep running during long dumps.
+ Any other message but real-time ones would end the frame early: they are
+ rejected until isSendingPacedSysEx() returns false, and isSendAccepted()
+ returns false for them.
+ \warning Thru is not deferred: incoming messages but real-time ones are not
+ echoed at all while the frame is sent, however long it takes.
+ Requires Settings::UsePacedSysEx. A frame already being sent is not
+ interrupted: starting another one is rejected the same way.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendPacedSysEx(unsigned inLength,
+                                                                                                                                  const byte* inArray,
+                                                                                                                                  unsigned inChunkSize,
+                                                                                                                                  unsigned long inChunkGap,
+                                                                                                                                  bool inArrayContainsBoundaries)
+{
+    static_assert(Settings::UsePacedSysEx, "sendPacedSysEx requires Settings::UsePacedSysEx");
+
+    if (this->rejectDuringPacedSysEx(SystemExclusive))
+        return *this;
+
+    this->startPacedSysEx(inArray, inLength, inChunkSize, inChunkGap, inArrayContainsBoundaries);
+    this->resetRunningStatusTx();
+    updatePacedSysEx();
+
+    return *this;
+}
+
+/*! \brief Check if a frame started with sendPacedSysEx is still being sent.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+inline bool MidiInterface<Transport, Settings, Platform, Handler>::isSendingPacedSysEx() const
+{
+    return this->isPacedSysExActive();
+}
+
+/*! \brief Encode binary data and send it in a System Exclusive frame.
+ \param inHeader  The bytes sent as they are after 0xf0 (eg: manufacturer ID
+ and command), they must be 7 bits values.
+ \param inHeaderLength The size of the header
+ \param inData    The binary data to encode and send
+ \param inDataLength The size of the data
+ \param inFlipHeaderBits True for Korg and other who store MSB in reverse order
+ \param inAppendChecksum True to send a Roland style checksum after the
+ encoded data: the value that brings the sum of the encoded bytes and the
+ checksum to a multiple of 128.
+
+ The data is encoded as with encodeSysEx, 7 bytes at a time, and written
+ without an intermediate buffer the size of the encoded data, eg: to send
+ a firmware image without copying it to RAM.
+ @see encodeSysEx
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendEncodedSysEx(const byte* inHeader,
+                                                                                                                                    unsigned inHeaderLength,
+                                                                                                                                    const byte* inData,
+                                                                                                                                    unsigned inDataLength,
+                                                                                                                                    bool inFlipHeaderBits,
+                                                                                                                                    bool inAppendChecksum)
+{
+    const unsigned encodedLength = inDataLength + (inDataLength + 6) / 7;
+    const unsigned length = 2 + inHeaderLength + encodedLength + (inAppendChecksum ? 1 : 0);
+
+    if (beginTransmission(MidiType::SystemExclusiveStart, length))
+    {
+        write(MidiType::SystemExclusiveStart);
+        write(inHeader, inHeaderLength);
+
+        byte sum = 0;
+        for (unsigned i = 0; i < inDataLength; i += 7)
+        {
+            // Group of up to 7 bytes, preceded by their MSBs
+            byte group[8] = { 0 };
+            const unsigned count = (inDataLength - i < 7) ? inDataLength - i : 7;
+            for (unsigned j = 0; j < count; ++j)
+            {
+                const byte data = inData[i + j];
+                group[0] = byte(group[0] | ((data >> 7) << (inFlipHeaderBits ? j : 6 - j)));
+                group[1 + j] = data & 0x7f;
+            }
+            for (unsigned j = 0; j <= count; ++j)
+                sum = byte(sum + group[j]);
+
+            write(group, count + 1);
+        }
+
+        if (inAppendChecksum)
+            write(byte((128 - (sum & 0x7f)) & 0x7f));
+
+        write(MidiType::SystemExclusiveEnd);
+
+        endTransmission();
+        updateLastSentTime();
+    }
+
+    this->resetRunningStatusTx();
 
     return *this;
 }
@@ -395,8 +549,8 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
  When a MIDI unit receives this message,
  it should tune its oscillators (if equipped with any).
  */
-template<class Transport, class Settings, class Platform>
-MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendTuneRequest()
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendTuneRequest()
 {
     return sendCommon(TuneRequest);
 }
@@ -407,8 +561,8 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
  \param inValuesNibble    MTC data
  See MIDI Specification for more information.
  */
-template<class Transport, class Settings, class Platform>
-MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendTimeCodeQuarterFrame(DataByte inTypeNibble,
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendTimeCodeQuarterFrame(DataByte inTypeNibble,
                                                                             DataByte inValuesNibble)
 {
     const byte data = byte((((inTypeNibble & 0x07) << 4) | (inValuesNibble & 0x0f)));
@@ -421,8 +575,8 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
  \param inData  if you want to encode directly the nibbles in your program,
                 you can send the byte here.
  */
-template<class Transport, class Settings, class Platform>
-MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendTimeCodeQuarterFrame(DataByte inData)
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendTimeCodeQuarterFrame(DataByte inData)
 {
     return sendCommon(TimeCodeQuarterFrame, inData);
 }
@@ -430,15 +584,15 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
 /*! \brief Send a Song Position Pointer message.
  \param inBeats    The number of beats since the start of the song.
  */
-template<class Transport, class Settings, class Platform>
-MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendSongPosition(unsigned inBeats)
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendSongPosition(unsigned inBeats)
 {
     return sendCommon(SongPosition, inBeats);
 }
 
 /*! \brief Send a Song Select message */
-template<class Transport, class Settings, class Platform>
-MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendSongSelect(DataByte inSongNumber)
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendSongSelect(DataByte inSongNumber)
 {
     return sendCommon(SongSelect, inSongNumber);
 }
@@ -450,8 +604,8 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
  @see MidiType
  \param inData1   The byte that goes with the common message.
  */
-template<class Transport, class Settings, class Platform>
-MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendCommon(MidiType inType, unsigned inData1)
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendCommon(MidiType inType, unsigned inData1)
 {
     switch (inType)
     {
@@ -465,20 +619,20 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
             return *this;
     }
 
-    if (mTransport.beginTransmission(inType))
+    if (beginTransmission(inType, 3))
     {
-            mTransport.write((byte)inType);
+            write((byte)inType);
             switch (inType)
             {
             case TimeCodeQuarterFrame:
-                mTransport.write(inData1);
+                write(inData1);
                 break;
             case SongPosition:
-                mTransport.write(inData1 & 0x7f);
-                mTransport.write((inData1 >> 7) & 0x7f);
+                write(inData1 & 0x7f);
+                write((inData1 >> 7) & 0x7f);
                 break;
             case SongSelect:
-                mTransport.write(inData1 & 0x7f);
+                write(inData1 & 0x7f);
                 break;
             case TuneRequest:
                 break;
@@ -487,12 +641,11 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
                 break;
             // LCOV_EXCL_STOP
         }
-        mTransport.endTransmission();
+        endTransmission();
         updateLastSentTime();
     }
 
-    if (Settings::UseRunningStatus)
-        mRunningStatus_TX = InvalidType;
+    this->resetRunningStatusTx();
 
     return *this;
 }
@@ -503,8 +656,8 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
  Start, Stop, Continue, Clock, ActiveSensing and SystemReset.
  @see MidiType
  */
-template<class Transport, class Settings, class Platform>
-MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendRealTime(MidiType inType)
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendRealTime(MidiType inType)
 {
     // Do not invalidate Running Status for real-time messages
     // as they can be interleaved within any message.
@@ -517,13 +670,29 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
         case Continue:
         case ActiveSensing:
         case SystemReset:
-            if (mTransport.beginTransmission(inType))
+        {
+            bool sent = false;
+            if (Settings::TxQueueSize && Settings::RealTimeQueueSize)
+            {
+                // Written by pump() before the queued messages
+                sent = TransmitQueue::pushRealTime(inType);
+            }
+            else if (beginTransmission(inType, 1))
+            {
+                write((byte)inType);
+                endTransmission();
+                sent = true;
+            }
+
+            if (sent)
             {
-                mTransport.write((byte)inType);
-                mTransport.endTransmission();
                 updateLastSentTime();
+
+                if (inType == SystemReset)
+                    LastSentValues::clear(MIDI_CHANNEL_OMNI);
             }
             break;
+        }
         default:
             // Invalid Real Time marker
             break;
@@ -536,8 +705,8 @@ MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings,
  \param inNumber The 14-bit number of the RPN you want to select.
  \param inChannel The channel on which the message will be sent (1 to 16).
 */
-template<class Transport, class Settings, class Platform>
-inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::beginRpn(unsigned inNumber,
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::beginRpn(unsigned inNumber,
                                                           Channel inChannel)
 {
     if (mCurrentRpnNumber != inNumber)
@@ -546,7 +715,7 @@ inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Se
         const byte numLsb = 0x7f & inNumber;
         sendControlChange(RPNLSB, numLsb, inChannel);
         sendControlChange(RPNMSB, numMsb, inChannel);
-        mCurrentRpnNumber = inNumber;
+        mCurrentRpnNumber = uint16_t(inNumber);
     }
 
     return *this;
@@ -556,8 +725,8 @@ inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Se
  \param inValue  The 14-bit value of the selected RPN.
  \param inChannel The channel on which the message will be sent (1 to 16).
 */
-template<class Transport, class Settings, class Platform>
-inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendRpnValue(unsigned inValue,
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendRpnValue(unsigned inValue,
                                                               Channel inChannel)
 {;
     const byte valMsb = 0x7f & (inValue >> 7);
@@ -573,8 +742,8 @@ inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Se
  \param inLsb The LSB part of the value to send. Meaning depends on RPN number.
  \param inChannel The channel on which the message will be sent (1 to 16).
 */
-template<class Transport, class Settings, class Platform>
-inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendRpnValue(byte inMsb,
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendRpnValue(byte inMsb,
                                                               byte inLsb,
                                                               Channel inChannel)
 {
@@ -587,8 +756,8 @@ inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Se
 /* \brief Increment the value of the currently selected RPN number by the specified amount.
  \param inAmount The amount to add to the currently selected RPN value.
 */
-template<class Transport, class Settings, class Platform>
-inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendRpnIncrement(byte inAmount,
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendRpnIncrement(byte inAmount,
                                                                   Channel inChannel)
 {
     sendControlChange(DataIncrement, inAmount, inChannel);
@@ -599,8 +768,8 @@ inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Se
 /* \brief Decrement the value of the currently selected RPN number by the specified amount.
  \param inAmount The amount to subtract to the currently selected RPN value.
 */
-template<class Transport, class Settings, class Platform>
-inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendRpnDecrement(byte inAmount,
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendRpnDecrement(byte inAmount,
                                                                   Channel inChannel)
 {
     sendControlChange(DataDecrement, inAmount, inChannel);
@@ -612,8 +781,8 @@ inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Se
 This will send a Null Function to deselect the currently selected RPN.
  \param inChannel The channel on which the message will be sent (1 to 16).
 */
-template<class Transport, class Settings, class Platform>
-inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::endRpn(Channel inChannel)
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::endRpn(Channel inChannel)
 {
     sendControlChange(RPNLSB, 0x7f, inChannel);
     sendControlChange(RPNMSB, 0x7f, inChannel);
@@ -628,8 +797,8 @@ inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Se
  \param inNumber The 14-bit number of the NRPN you want to select.
  \param inChannel The channel on which the message will be sent (1 to 16).
 */
-template<class Transport, class Settings, class Platform>
-inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::beginNrpn(unsigned inNumber,
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::beginNrpn(unsigned inNumber,
                                                            Channel inChannel)
 {
     if (mCurrentNrpnNumber != inNumber)
@@ -638,7 +807,7 @@ inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Se
         const byte numLsb = 0x7f & inNumber;
         sendControlChange(NRPNLSB, numLsb, inChannel);
         sendControlChange(NRPNMSB, numMsb, inChannel);
-        mCurrentNrpnNumber = inNumber;
+        mCurrentNrpnNumber = uint16_t(inNumber);
     }
 
     return *this;
@@ -648,8 +817,8 @@ inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Se
  \param inValue  The 14-bit value of the selected NRPN.
  \param inChannel The channel on which the message will be sent (1 to 16).
 */
-template<class Transport, class Settings, class Platform>
-inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendNrpnValue(unsigned inValue,
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendNrpnValue(unsigned inValue,
                                                                Channel inChannel)
 {
     const byte valMsb = 0x7f & (inValue >> 7);
@@ -665,8 +834,8 @@ inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Se
  \param inLsb The LSB part of the value to send. Meaning depends on NRPN number.
  \param inChannel The channel on which the message will be sent (1 to 16).
 */
-template<class Transport, class Settings, class Platform>
-inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendNrpnValue(byte inMsb,
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendNrpnValue(byte inMsb,
                                                                byte inLsb,
                                                                Channel inChannel)
 {
@@ -679,8 +848,8 @@ inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Se
 /* \brief Increment the value of the currently selected NRPN number by the specified amount.
  \param inAmount The amount to add to the currently selected NRPN value.
 */
-template<class Transport, class Settings, class Platform>
-inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendNrpnIncrement(byte inAmount,
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendNrpnIncrement(byte inAmount,
                                                                    Channel inChannel)
 {
     sendControlChange(DataIncrement, inAmount, inChannel);
@@ -691,8 +860,8 @@ inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Se
 /* \brief Decrement the value of the currently selected NRPN number by the specified amount.
  \param inAmount The amount to subtract to the currently selected NRPN value.
 */
-template<class Transport, class Settings, class Platform>
-inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::sendNrpnDecrement(byte inAmount,
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::sendNrpnDecrement(byte inAmount,
                                                                    Channel inChannel)
 {
     sendControlChange(DataDecrement, inAmount, inChannel);
@@ -704,8 +873,8 @@ inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Se
 This will send a Null Function to deselect the currently selected NRPN.
  \param inChannel The channel on which the message will be sent (1 to 16).
 */
-template<class Transport, class Settings, class Platform>
-inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::endNrpn(Channel inChannel)
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::endNrpn(Channel inChannel)
 {
     sendControlChange(NRPNLSB, 0x7f, inChannel);
     sendControlChange(NRPNMSB, 0x7f, inChannel);
@@ -714,19 +883,355 @@ inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Se
     return *this;
 }
 
-template<class Transport, class Settings, class Platform>
-inline void MidiInterface<Transport, Settings, Platform>::updateLastSentTime()
+template<class Transport, class Settings, class Platform, class Handler>
+inline void MidiInterface<Transport, Settings, Platform, Handler>::updateLastSentTime()
 {
-    if (Settings::UseSenderActiveSensing && mSenderActiveSensingPeriodicity)
-        mLastMessageSentTime = Platform::now();
+    this->updateSentTime();
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Start grouping the messages sent into a single transmission.
+ \param inSizeHint The number of bytes about to be sent, passed to transports
+ taking a size hint (see TransportAdapter), or 0 if unknown.
+
+ Until commitBatch is called, the transport gets a single beginTransmission
+ (with the type of the first message) and the messages are written one after
+ the other, eg: a chord or a bank select and program change in one USB or BLE
+ packet. With a transmit queue, the batch is queued as a single entry and
+ becomes visible to pump() on commitBatch. Batches cannot be nested.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::beginBatch(unsigned inSizeHint)
+{
+    if (!mBatchActive)
+    {
+        mBatchActive   = true;
+        mBatchOpen     = false;
+        mBatchSizeHint = uint16_t(inSizeHint);
+    }
+    return *this;
+}
+
+/*! \brief End the transmission started by beginBatch.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::commitBatch()
+{
+    const bool open = mBatchOpen;
+    mBatchActive = false;
+    mBatchOpen   = false;
+
+    if (open)
+        endTransmission();
+
+    return *this;
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Write queued messages to the transport.
+ \param inMaxBytes The maximum number of bytes to write, eg: the room left
+ in the hardware transmit buffer. A message can be written over several calls.
+ \return The number of bytes written.
+
+ Call it from loop(), a transmit interrupt or another thread when using a
+ transmit queue (see Settings::TxQueueSize), does nothing otherwise.
+ Reading does not pump the queue: input and Thru never wait for outgoing
+ transfers. Real-time messages come first with a real-time queue
+ (see Settings::RealTimeQueueSize).
+ It only writes what is already queued, see update() for the messages sent
+ later.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+inline unsigned MidiInterface<Transport, Settings, Platform, Handler>::pump(unsigned inMaxBytes)
+{
+    return TransmitQueue::pump(mTransport, inMaxBytes);
+}
+
+/*! \brief Send the messages that are due, without reading.
+ Sends the next chunk of a paced SysEx and the scheduled messages when due
+ (see sendPacedSysEx and sendAt), with or without a transmit queue.
+ read() calls it: only call it when not reading, eg: from loop().
+ Unlike pump(), it sends messages, so call it from the context that sends
+ the other messages and not from a transmit interrupt.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+inline void MidiInterface<Transport, Settings, Platform, Handler>::update()
+{
+    updatePacedSysEx();
+    updateSchedule();
+}
+
+/*! \brief Check if the last message sent has been accepted.
+ \return false if the transmit queue was too full to hold the message, or
+ if it would have ended a paced SysEx (see sendPacedSysEx). The message has
+ then been dropped.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+inline bool MidiInterface<Transport, Settings, Platform, Handler>::isSendAccepted() const
+{
+    return TransmitQueue::isAccepted() && !this->isRejectedDuringPacedSysEx();
+}
+
+/*! \brief Free space in the transmit queue, in bytes.
+ Each message takes its length plus TxQueue::sHeaderSize bytes.
+ Always 0 without a transmit queue.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+inline unsigned MidiInterface<Transport, Settings, Platform, Handler>::getTxQueueAvailable() const
+{
+    return TransmitQueue::available();
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Schedule a message to be sent later.
+ \param inTime The time at which to send it, in Platform::now() units
+ (milliseconds by default), eg: now() + 250 for a delay effect.
+ \param inMessage The message to send (see PackedMessage, SysEx messages
+ cannot be scheduled).
+ \return false if the schedule is full (see Settings::ScheduleMaxSize), the
+ message is then dropped.
+
+ Scheduled messages are sent by read() or update() once their time has come,
+ in order of time, and in the order they were scheduled for the same time.
+ A due message that is not accepted (see isSendAccepted) stays scheduled,
+ along with the ones after it, until the next update.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+inline bool MidiInterface<Transport, Settings, Platform, Handler>::sendAt(unsigned long inTime,
+                                                                          PackedMessage inMessage)
+{
+    return Schedule::push(inTime, inMessage);
+}
+
+/*! \brief Number of messages waiting to be sent, see sendAt.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+inline unsigned MidiInterface<Transport, Settings, Platform, Handler>::getScheduledCount() const
+{
+    return Schedule::size();
+}
+
+/*! \brief Drop the messages waiting to be sent, eg: when a sequencer stops.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::clearSchedule()
+{
+    Schedule::clear();
+    return *this;
+}
+
+/*! \brief Forget the values sent, so that the next ones are sent even if
+ they repeat them (see Settings::UseOutputCache).
+ \param inChannel The channel to forget (1 to 16), or MIDI_CHANNEL_OMNI for
+ all of them.
+
+ Call it when the receiver may have lost its state, eg: after it was reset
+ or reconnected. Sending a SystemReset does it too, and a Reset All
+ Controllers Control Change forgets the controllers of its channel.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::invalidateOutputCache(Channel inChannel)
+{
+    LastSentValues::clear(inChannel);
+    return *this;
+}
+
+/*! \brief Send the values of a channel that differ from the ones last sent.
+ \param inState The target state, its unset values are left as they are.
+ \param inChannel The channel on which the messages will be sent (1 to 16).
+
+ Bank Select is sent first, followed by the Program Change (sent again on
+ a bank change, even if the program is the same), the other controllers,
+ channel pressure and pitch bend.
+ Values are compared with the output cache (see Settings::UseOutputCache),
+ without it all the values set in the state are sent.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::syncTo(const ChannelState& inState,
+                                                                                                                          Channel inChannel)
+{
+    if (inChannel == MIDI_CHANNEL_OMNI || inChannel >= MIDI_CHANNEL_OFF)
+        return *this;
+
+    // Sending a new bank makes the cache forget the program, which is then
+    // sent again to select it.
+    static const byte bankControls[] = { BankSelect, BankSelectLSB };
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        const byte value = inState.controls[bankControls[i]];
+        if (value != ChannelState::sUnset)
+            sendControlChange(bankControls[i], value, inChannel);
+    }
+
+    if (inState.program != ChannelState::sUnset)
+        sendProgramChange(inState.program, inChannel);
+
+    for (byte control = 0; control < ChannelState::sNumControls; ++control)
+    {
+        if (control == BankSelect || control == BankSelectLSB ||
+            !ChannelState::isHeld(control))
+            continue;
+
+        if (inState.controls[control] != ChannelState::sUnset)
+            sendControlChange(control, inState.controls[control], inChannel);
+    }
+
+    if (inState.pressure != ChannelState::sUnset)
+        sendAfterTouch(inState.pressure, inChannel);
+
+    if (inState.pitchBend != ChannelState::sUnsetPitchBend)
+        send(PitchBend, byte(inState.pitchBend & 0x7f), byte((inState.pitchBend >> 7) & 0x7f), inChannel);
+
+    return *this;
+}
+
+/*! \brief Send the values of all channels that differ from the ones last sent.
+ \param inStates The target states of channels 1 to 16.
+ @see syncTo(const ChannelState&, Channel)
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::syncTo(const ChannelState (&inStates)[16])
+{
+    for (Channel channel = 1; channel <= 16; ++channel)
+        syncTo(inStates[channel - 1], channel);
+
+    return *this;
+}
+
+// Private methods: messages are either written directly to the transport,
+// or queued whole when Settings::TxQueueSize is not 0.
+// Transports with a bulk write get each message in one call, SysEx payloads
+// are passed as they are.
+// In a batch, only the first message begins a transmission,
+// which is ended by commitBatch.
+// While a paced SysEx is sent, only its chunks and real-time messages
+// begin a transmission.
+template<class Transport, class Settings, class Platform, class Handler>
+inline bool MidiInterface<Transport, Settings, Platform, Handler>::beginTransmission(MidiType inType,
+                                                                                     unsigned inMaxLength)
+{
+    if (this->rejectDuringPacedSysEx(inType))
+        return false; // Would end the paced SysEx
+
+    if (mBatchOpen)
+        return TransmitQueue::extend(inMaxLength);
+
+    const unsigned sizeHint = (mBatchActive && mBatchSizeHint > inMaxLength) ? mBatchSizeHint : inMaxLength;
+    const bool begun = (Settings::TxQueueSize > 0)
+                     ? TransmitQueue::reserve(inType, inMaxLength)
+                     : TransportAdapter::beginTransmission(mTransport, inType, sizeHint);
+
+    mBatchOpen = mBatchActive && begun;
+    return begun;
+}
+
+template<class Transport, class Settings, class Platform, class Handler>
+inline void MidiInterface<Transport, Settings, Platform, Handler>::write(byte inByte)
+{
+    if (Settings::TxQueueSize > 0)
+    {
+        TransmitQueue::push(inByte);
+    }
+    else if (TransportAdapter::HasBulkWrite<Transport>::value)
+    {
+        if (TransmitChunk::full())
+            TransmitChunk::flush(mTransport);
+        TransmitChunk::push(inByte);
+    }
+    else
+    {
+        mTransport.write(inByte);
+    }
+}
+
+template<class Transport, class Settings, class Platform, class Handler>
+inline void MidiInterface<Transport, Settings, Platform, Handler>::write(const byte* inData,
+                                                                         unsigned inLength)
+{
+    if (Settings::TxQueueSize > 0)
+    {
+        for (unsigned i = 0; i < inLength; ++i)
+            TransmitQueue::push(inData[i]);
+    }
+    else
+    {
+        TransmitChunk::flush(mTransport);
+        TransportAdapter::write(mTransport, inData, inLength);
+    }
+}
+
+template<class Transport, class Settings, class Platform, class Handler>
+inline void MidiInterface<Transport, Settings, Platform, Handler>::endTransmission()
+{
+    if (mBatchActive)
+        return; // Ended by commitBatch
+
+    if (Settings::TxQueueSize > 0)
+    {
+        TransmitQueue::commit();
+    }
+    else
+    {
+        TransmitChunk::flush(mTransport);
+        mTransport.endTransmission();
+    }
+}
+
+// Private method: write the next chunk of a paced SysEx when it is due.
+// It is written again on the next call if it could not be sent.
+template<class Transport, class Settings, class Platform, class Handler>
+inline void MidiInterface<Transport, Settings, Platform, Handler>::updatePacedSysEx()
+{
+    const unsigned length = this->beginPacedSysExChunk();
+    if (length == 0)
+        return;
+
+    const bool sent = beginTransmission(SystemExclusive, length);
+    if (sent)
+    {
+        for (unsigned i = 0; i < length; ++i)
+            write(this->getPacedSysExByte(i));
+
+        endTransmission();
+        updateLastSentTime();
+    }
+
+    this->endPacedSysExChunk(sent, length);
+}
+
+// Private method: send the scheduled messages that are due.
+template<class Transport, class Settings, class Platform, class Handler>
+inline void MidiInterface<Transport, Settings, Platform, Handler>::updateSchedule()
+{
+    if (Schedule::size() == 0)
+        return;
+
+    const unsigned long now = Platform::now();
+    PackedMessage message;
+    while (Schedule::peek(now, message))
+    {
+        // Skipped by the output cache: done, whatever isSendAccepted says
+        const bool redundant = message.type() <= PitchBend &&
+            LastSentValues::isRedundant(message.type(), message.data1(), message.data2(), message.channel());
+        if (!redundant)
+        {
+            send(message);
+            if (!isSendAccepted())
+                return; // Kept to be sent again by the next update
+        }
+        Schedule::pop();
+    }
 }
 
 /*! @} */ // End of doc group MIDI Output
 
 // -----------------------------------------------------------------------------
 
-template<class Transport, class Settings, class Platform>
-StatusByte MidiInterface<Transport, Settings, Platform>::getStatus(MidiType inType,
+template<class Transport, class Settings, class Platform, class Handler>
+StatusByte MidiInterface<Transport, Settings, Platform, Handler>::getStatus(MidiType inType,
                                                           Channel inChannel) const
 {
     return StatusByte(((byte)inType | ((inChannel - 1) & 0x0f)));
@@ -748,16 +1253,16 @@ StatusByte MidiInterface<Transport, Settings, Platform>::getStatus(MidiType inTy
  it is sent back on the MIDI output.
  @see see setInputChannel()
  */
-template<class Transport, class Settings, class Platform>
-inline bool MidiInterface<Transport, Settings, Platform>::read()
+template<class Transport, class Settings, class Platform, class Handler>
+inline bool MidiInterface<Transport, Settings, Platform, Handler>::read()
 {
     return read(mInputChannel);
 }
 
 /*! \brief Read messages on a specified channel.
  */
-template<class Transport, class Settings, class Platform>
-inline bool MidiInterface<Transport, Settings, Platform>::read(Channel inChannel)
+template<class Transport, class Settings, class Platform, class Handler>
+inline bool MidiInterface<Transport, Settings, Platform, Handler>::read(Channel inChannel)
 {
     #ifndef RegionActiveSending
     // Active Sensing. This message is intended to be sent
@@ -768,67 +1273,89 @@ inline bool MidiInterface<Transport, Settings, Platform>::read(Channel inChannel
     // assume that the connection has been terminated. At
     // termination, the receiver will turn off all voices and return to
     // normal (non- active sensing) operation.
-    if (Settings::UseSenderActiveSensing && (mSenderActiveSensingPeriodicity > 0) && (Platform::now() - mLastMessageSentTime) > mSenderActiveSensingPeriodicity)
+    if (this->isActiveSensingDue())
     {
         sendActiveSensing();
-        mLastMessageSentTime = Platform::now();
+        this->resetLastSentTime();
     }
 
-    if (Settings::UseReceiverActiveSensing && mReceiverActiveSensingActivated && (mLastMessageReceivedTime + ActiveSensingTimeout < Platform::now()))
-    {
-        mReceiverActiveSensingActivated = false;
-
-        mLastError |= 1UL << ErrorActiveSensingTimeout; // set the ErrorActiveSensingTimeout bit
-        if (mErrorCallback)
-            mErrorCallback(mLastError);
-    }
+    this->checkActiveSensingTimeout();
     #endif
 
+    update();
+
+    // The last message has been dispatched
+    this->releaseSysEx();
+
     if (inChannel >= MIDI_CHANNEL_OFF)
         return false; // MIDI Input disabled.
 
     if (!parse())
         return false;
 
-    #ifndef RegionActiveSending
+    const bool channelMatch = this->dispatch(inChannel);
 
-    if (Settings::UseReceiverActiveSensing && mMessage.type == ActiveSensing)
-    {
-        // When an ActiveSensing message is received, the time keeping is activated.
-        // When a timeout occurs, an error message is send and time keeping ends.
-        mReceiverActiveSensingActivated = true;
+    thruFilter(inChannel);
 
-        // is ErrorActiveSensingTimeout bit in mLastError on
-        if (mLastError & (1 << (ErrorActiveSensingTimeout - 1)))
-        {
-            mLastError &= ~(1UL << ErrorActiveSensingTimeout); // clear the ErrorActiveSensingTimeout bit
-            if (mErrorCallback)
-                mErrorCallback(mLastError);
-        }
-    }
+    return channelMatch;
+}
 
-    // Keep the time of the last received message, so we can check for the timeout
-    if (Settings::UseReceiverActiveSensing && mReceiverActiveSensingActivated)
-        mLastMessageReceivedTime = Platform::now();
+/*! \brief Read messages using the main input channel, and pass them to a visitor.
 
-    #endif
+ The visitor is called with a typed event (eg: NoteOnEvent) for each valid
+ message, see visit(). Unlike the setHandle* callbacks, the visitor is not
+ stored in the interface: functors and lambdas can carry state and are
+ inlined. Use EmptyHandler as the Handler template parameter when this is
+ the only input path, to drop the callback table altogether.
+ \n Chunks of SystemExclusive messages split across the input buffer
+ (see Settings::SysExMaxSize) are only passed to the handler.
+ \return True if a valid message has been passed to the visitor.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+template<class Visitor>
+inline typename EnableIf<IsClass<Visitor>::value, bool>::type
+MidiInterface<Transport, Settings, Platform, Handler>::read(Visitor& inVisitor)
+{
+    return read(mInputChannel, inVisitor);
+}
 
-    handleNullVelocityNoteOnAsNoteOff();
+/*! \brief Read messages on a specified channel, and pass them to a visitor.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+template<class Visitor>
+inline bool MidiInterface<Transport, Settings, Platform, Handler>::read(Channel inChannel,
+                                                                        Visitor& inVisitor)
+{
+    if (!read(inChannel))
+        return false;
 
-    const bool channelMatch = inputFilter(inChannel);
-    if (channelMatch)
-        launchCallback();
+    visit(mMessage, inVisitor);
+    return true;
+}
 
-    thruFilter(inChannel);
+#ifdef MIDI_HAS_COROUTINES
+/*! \brief Wait for the next valid message on the main input channel,
+ from a coroutine (host builds only).
 
-    return channelMatch;
+ \code{.cpp}
+ const auto message = co_await midi.next(executor);
+ \endcode
+ The coroutine is resumed by the executor once the transport is readable and
+ a complete message has been parsed, rather than busy-polling read().
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+inline MessageAwaiter<MidiInterface<Transport, Settings, Platform, Handler> >
+MidiInterface<Transport, Settings, Platform, Handler>::next(PollExecutor& inExecutor)
+{
+    return MessageAwaiter<MidiInterface>(*this, inExecutor);
 }
+#endif
 
 // -----------------------------------------------------------------------------
 
 // Private method: MIDI parser
-template<class Transport, class Settings, class Platform>
-bool MidiInterface<Transport, Settings, Platform>::parse()
+template<class Transport, class Settings, class Platform, class Handler>
+bool MidiInterface<Transport, Settings, Platform, Handler>::parse()
 {
     if (mTransport.available() == 0)
         return false; // No data available.
@@ -836,352 +1363,35 @@ bool MidiInterface<Transport, Settings, Platform>::parse()
     // clear the ErrorParse bit
     mLastError &= ~(1UL << ErrorParse);
 
-    // Parsing algorithm:
-    // Get a byte from the serial buffer.
-    // If there is no pending message to be recomposed, start a new one.
-    //  - Find type and channel (if pertinent)
-    //  - Look for other bytes in buffer, call parser recursively,
-    //    until the message is assembled or the buffer is empty.
-    // Else, add the extracted byte to the pending message, and check validity.
-    // When the message is done, store it.
-
-    const byte extracted = mTransport.read();
-
-    // Ignore Undefined
-    if (extracted == Undefined_FD)
-        return (Settings::Use1ByteParsing) ? false : parse();
-
-    if (mPendingMessageIndex == 0)
+    // Get bytes from the serial buffer and feed them to the parser,
+    // until a message is assembled or the buffer is empty.
+    for (;;)
     {
-        // Start a new pending message
-        mPendingMessage[0] = extracted;
-
-        // Check for running status first
-        if (isChannelMessage(getTypeFromStatusByte(mRunningStatus_RX)))
+        switch (this->receive(mTransport.read()))
         {
-            // Only these types allow Running Status
-
-            // If the status byte is not received, prepend it
-            // to the pending message
-            if (extracted < 0x80)
-            {
-                mPendingMessage[0]   = mRunningStatus_RX;
-                mPendingMessage[1]   = extracted;
-                mPendingMessageIndex = 1;
-            }
-            // Else: well, we received another status byte,
-            // so the running status does not apply here.
-            // It will be updated upon completion of this message.
-        }
-
-        const MidiType pendingType = getTypeFromStatusByte(mPendingMessage[0]);
-
-        switch (pendingType)
-        {
-            // 1 byte messages
-            case Start:
-            case Continue:
-            case Stop:
-            case Clock:
-            case Tick:
-            case ActiveSensing:
-            case SystemReset:
-            case TuneRequest:
-                // Handle the message type directly here.
-                mMessage.type    = pendingType;
-                mMessage.channel = 0;
-                mMessage.data1   = 0;
-                mMessage.data2   = 0;
-                mMessage.valid   = true;
-
-                // Do not reset all input attributes, Running Status must remain unchanged.
-                // We still need to reset these
-                mPendingMessageIndex = 0;
-                mPendingMessageExpectedLength = 0;
-
+            case MidiParser::Complete:
                 return true;
-                break;
 
-            // 2 bytes messages
-            case ProgramChange:
-            case AfterTouchChannel:
-            case TimeCodeQuarterFrame:
-            case SongSelect:
-                mPendingMessageExpectedLength = 2;
-                break;
-
-            // 3 bytes messages
-            case NoteOn:
-            case NoteOff:
-            case ControlChange:
-            case PitchBend:
-            case AfterTouchPoly:
-            case SongPosition:
-                mPendingMessageExpectedLength = 3;
-                break;
-
-            case SystemExclusiveStart:
-            case SystemExclusiveEnd:
-                // The message can be any length
-                // between 3 and MidiMessage::sSysExMaxSize bytes
-                mPendingMessageExpectedLength = MidiMessage::sSysExMaxSize;
-                mRunningStatus_RX = InvalidType;
-                mMessage.sysexArray[0] = pendingType;
+            case MidiParser::Pending:
                 break;
 
-            case InvalidType:
             default:
-                // This is obviously wrong. Let's get the hell out'a here.
-                mLastError |= 1UL << ErrorParse; // set the ErrorParse bit
-                if (mErrorCallback)
-                    mErrorCallback(mLastError); // LCOV_EXCL_LINE
-
-                resetInput();
-                return false;
-                break;
-        }
-
-        if (mPendingMessageIndex >= (mPendingMessageExpectedLength - 1))
-        {
-            // Reception complete
-            mMessage.type    = pendingType;
-            mMessage.channel = getChannelFromStatusByte(mPendingMessage[0]);
-            mMessage.data1   = mPendingMessage[1];
-            mMessage.data2   = 0; // Completed new message has 1 data byte
-            mMessage.length  = 1;
-
-            mPendingMessageIndex = 0;
-            mPendingMessageExpectedLength = 0;
-            mMessage.valid = true;
-
-            return true;
-        }
-        else
-        {
-            // Waiting for more data
-            mPendingMessageIndex++;
-        }
-
-        return (Settings::Use1ByteParsing) ? false : parse();
-    }
-    else
-    {
-        // First, test if this is a status byte
-        if (extracted >= 0x80)
-        {
-            // Reception of status bytes in the middle of an uncompleted message
-            // are allowed only for interleaved Real Time message or EOX
-            switch (extracted)
-            {
-                case Clock:
-                case Start:
-                case Tick:
-                case Continue:
-                case Stop:
-                case ActiveSensing:
-                case SystemReset:
-
-                    // Here we will have to extract the one-byte message,
-                    // pass it to the structure for being read outside
-                    // the MIDI class, and recompose the message it was
-                    // interleaved into. Oh, and without killing the running status..
-                    // This is done by leaving the pending message as is,
-                    // it will be completed on next calls.
-
-                    mMessage.type    = (MidiType)extracted;
-                    mMessage.data1   = 0;
-                    mMessage.data2   = 0;
-                    mMessage.channel = 0;
-                    mMessage.length  = 1;
-                    mMessage.valid   = true;
-
-                    return true;
-
-                    // Exclusive
-                case SystemExclusiveStart:
-                case SystemExclusiveEnd:
-                    if ((mMessage.sysexArray[0] == SystemExclusiveStart)
-                    ||  (mMessage.sysexArray[0] == SystemExclusiveEnd))
-                    {
-                        // Store the last byte (EOX)
-                        mMessage.sysexArray[mPendingMessageIndex++] = extracted;
-                        mMessage.type = SystemExclusive;
-
-                        // Get length
-                        mMessage.data1   = mPendingMessageIndex & 0xff; // LSB
-                        mMessage.data2   = byte(mPendingMessageIndex >> 8);   // MSB
-                        mMessage.channel = 0;
-                        mMessage.length  = mPendingMessageIndex;
-                        mMessage.valid   = true;
-
-                        resetInput();
-
-                        return true;
-                    }
-                    else
-                    {
-                        // Well well well.. error.
-                        mLastError |= 1UL << ErrorParse; // set the error bits
-                        if (mErrorCallback)
-                            mErrorCallback(mLastError); // LCOV_EXCL_LINE
-
-                        resetInput();
-                        return false;
-                    }
-                // LCOV_EXCL_START - Coverage blind spot
-                default:
-                    break;
-                // LCOV_EXCL_STOP
-            }
-        }
-
-        // Add extracted data byte to pending message
-        if ((mPendingMessage[0] == SystemExclusiveStart)
-        ||  (mPendingMessage[0] == SystemExclusiveEnd))
-            mMessage.sysexArray[mPendingMessageIndex] = extracted;
-        else
-            mPendingMessage[mPendingMessageIndex] = extracted;
-
-        // Now we are going to check if we have reached the end of the message
-        if (mPendingMessageIndex >= (mPendingMessageExpectedLength - 1))
-        {
-            // SysEx larger than the allocated buffer size,
-            // Split SysEx like so:
-            //   first:  0xF0 .... 0xF0
-            //   midlle: 0xF7 .... 0xF0
-            //   last:   0xF7 .... 0xF7
-            if ((mPendingMessage[0] == SystemExclusiveStart)
-            ||  (mPendingMessage[0] == SystemExclusiveEnd))
-            {
-                auto lastByte = mMessage.sysexArray[Settings::SysExMaxSize - 1];
-                mMessage.sysexArray[Settings::SysExMaxSize - 1] = SystemExclusiveStart;
-                mMessage.type = SystemExclusive;
-
-                // Get length
-                mMessage.data1   = Settings::SysExMaxSize & 0xff; // LSB
-                mMessage.data2   = byte(Settings::SysExMaxSize >> 8); // MSB
-                mMessage.channel = 0;
-                mMessage.length  = Settings::SysExMaxSize;
-                mMessage.valid   = true;
-
-                // No need to check against the inputChannel,
-                // SysEx ignores input channel
-                launchCallback();
-
-                mMessage.sysexArray[0] = SystemExclusiveEnd;
-                mMessage.sysexArray[1] = lastByte;
-
-                mPendingMessageIndex = 2;
-
-                return false;
-            }
-
-            mMessage.type = getTypeFromStatusByte(mPendingMessage[0]);
-
-            if (isChannelMessage(mMessage.type))
-                mMessage.channel = getChannelFromStatusByte(mPendingMessage[0]);
-            else
-                mMessage.channel = 0;
-
-            mMessage.data1 = mPendingMessage[1];
-            // Save data2 only if applicable
-            mMessage.data2 = mPendingMessageExpectedLength == 3 ? mPendingMessage[2] : 0;
-            mMessage.length = mPendingMessageExpectedLength;
-
-            // Reset local variables
-            mPendingMessageIndex = 0;
-            mPendingMessageExpectedLength = 0;
-
-            mMessage.valid = true;
-
-            // Activate running status (if enabled for the received type)
-            switch (mMessage.type)
-            {
-                case NoteOff:
-                case NoteOn:
-                case AfterTouchPoly:
-                case ControlChange:
-                case ProgramChange:
-                case AfterTouchChannel:
-                case PitchBend:
-                    // Running status enabled: store it from received message
-                    mRunningStatus_RX = mPendingMessage[0];
-                    break;
-
-                default:
-                    // No running status
-                    mRunningStatus_RX = InvalidType;
-                    break;
-            }
-            return true;
+                return false; // SysEx chunk dispatched, or error reported
         }
-        else
-        {
-            // Then update the index of the pending message.
-            mPendingMessageIndex++;
-
-            return (Settings::Use1ByteParsing) ? false : parse();
-        }
-    }
-}
 
-// Private method, see midi_Settings.h for documentation
-template<class Transport, class Settings, class Platform>
-inline void MidiInterface<Transport, Settings, Platform>::handleNullVelocityNoteOnAsNoteOff()
-{
-    if (Settings::HandleNullVelocityNoteOnAsNoteOff &&
-        getType() == NoteOn && getData2() == 0)
-    {
-        mMessage.type = NoteOff;
-    }
-}
-
-// Private method: check if the received message is on the listened channel
-template<class Transport, class Settings, class Platform>
-inline bool MidiInterface<Transport, Settings, Platform>::inputFilter(Channel inChannel)
-{
-    // This method handles recognition of channel
-    // (to know if the message is destinated to the Arduino)
-
-    // First, check if the received message is Channel
-    if (mMessage.type >= NoteOff && mMessage.type <= PitchBend)
-    {
-        // Then we need to know if we listen to it
-        if ((mMessage.channel == inChannel) ||
-            (inChannel == MIDI_CHANNEL_OMNI))
-        {
-            return true;
-        }
-        else
-        {
-            // We don't listen to this channel
+        if (Settings::Use1ByteParsing || mTransport.available() == 0)
             return false;
-        }
-    }
-    else
-    {
-        // System messages are always received
-        return true;
     }
 }
 
-// Private method: reset input attributes
-template<class Transport, class Settings, class Platform>
-inline void MidiInterface<Transport, Settings, Platform>::resetInput()
-{
-    mPendingMessageIndex = 0;
-    mPendingMessageExpectedLength = 0;
-    mRunningStatus_RX = InvalidType;
-}
-
 // -----------------------------------------------------------------------------
 
 /*! \brief Get the last received message's type
 
  Returns an enumerated type. @see MidiType
  */
-template<class Transport, class Settings, class Platform>
-inline MidiType MidiInterface<Transport, Settings, Platform>::getType() const
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiType MidiInterface<Transport, Settings, Platform, Handler>::getType() const
 {
     return mMessage.type;
 }
@@ -1191,22 +1401,22 @@ inline MidiType MidiInterface<Transport, Settings, Platform>::getType() const
  \return Channel range is 1 to 16.
  For non-channel messages, this will return 0.
  */
-template<class Transport, class Settings, class Platform>
-inline Channel MidiInterface<Transport, Settings, Platform>::getChannel() const
+template<class Transport, class Settings, class Platform, class Handler>
+inline Channel MidiInterface<Transport, Settings, Platform, Handler>::getChannel() const
 {
     return mMessage.channel;
 }
 
 /*! \brief Get the first data byte of the last received message. */
-template<class Transport, class Settings, class Platform>
-inline DataByte MidiInterface<Transport, Settings, Platform>::getData1() const
+template<class Transport, class Settings, class Platform, class Handler>
+inline DataByte MidiInterface<Transport, Settings, Platform, Handler>::getData1() const
 {
     return mMessage.data1;
 }
 
 /*! \brief Get the second data byte of the last received message. */
-template<class Transport, class Settings, class Platform>
-inline DataByte MidiInterface<Transport, Settings, Platform>::getData2() const
+template<class Transport, class Settings, class Platform, class Handler>
+inline DataByte MidiInterface<Transport, Settings, Platform, Handler>::getData2() const
 {
     return mMessage.data2;
 }
@@ -1215,8 +1425,8 @@ inline DataByte MidiInterface<Transport, Settings, Platform>::getData2() const
 
  @see getSysExArrayLength to get the array's length in bytes.
  */
-template<class Transport, class Settings, class Platform>
-inline const byte* MidiInterface<Transport, Settings, Platform>::getSysExArray() const
+template<class Transport, class Settings, class Platform, class Handler>
+inline const byte* MidiInterface<Transport, Settings, Platform, Handler>::getSysExArray() const
 {
     return mMessage.sysexArray;
 }
@@ -1226,23 +1436,67 @@ inline const byte* MidiInterface<Transport, Settings, Platform>::getSysExArray()
  It is coded using data1 as LSB and data2 as MSB.
  \return The array's length, in bytes.
  */
-template<class Transport, class Settings, class Platform>
-inline unsigned MidiInterface<Transport, Settings, Platform>::getSysExArrayLength() const
+template<class Transport, class Settings, class Platform, class Handler>
+inline unsigned MidiInterface<Transport, Settings, Platform, Handler>::getSysExArrayLength() const
 {
     return mMessage.getSysExSize();
 }
 
 /*! \brief Check if a valid message is stored in the structure. */
-template<class Transport, class Settings, class Platform>
-inline bool MidiInterface<Transport, Settings, Platform>::check() const
+template<class Transport, class Settings, class Platform, class Handler>
+inline bool MidiInterface<Transport, Settings, Platform, Handler>::check() const
 {
     return mMessage.valid;
 }
 
 // -----------------------------------------------------------------------------
 
-template<class Transport, class Settings, class Platform>
-inline Channel MidiInterface<Transport, Settings, Platform>::getInputChannel() const
+/*! \brief Get the execution time statistics of the handler for a message type.
+
+ Each call made by the interface to the handler is timed with
+ Platform::now() when Settings::UseHandlerProfiler is enabled, otherwise the
+ statistics are always zero.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+inline HandlerStats MidiInterface<Transport, Settings, Platform, Handler>::getHandlerStats(MidiType inType) const
+{
+    return Profiler::getStats(inType);
+}
+
+/*! \brief Clear the handler execution time statistics.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+inline void MidiInterface<Transport, Settings, Platform, Handler>::resetHandlerStats()
+{
+    Profiler::reset();
+}
+
+/*! \brief Take the events received since the last block, for block-based
+ processing (eg: in an audio callback).
+
+ Messages read on the input channel are collected (up to
+ Settings::EventBlockMaxSize, SysEx excepted) instead of having to be handled
+ one callback at a time in between DSP work.
+ \param inBlockStartTime  Platform::now() time of the start of the block.
+ \param inSampleRate      Sample rate used to compute the events offsets.
+ \return The events, sorted and tagged with their offset in samples from the
+ start of the block (events received before the block start have an offset
+ of 0). The span is valid until the next call to read.
+ Times are converted using Settings::PlatformTicksPerSecond, and compared so
+ that Platform::now() wrapping around between the events and the block start
+ is handled.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+inline EventBlock MidiInterface<Transport, Settings, Platform, Handler>::takeBlock(unsigned long inBlockStartTime,
+                                                                              unsigned long inSampleRate)
+{
+    return EventBlockStorage::take(inBlockStartTime, inSampleRate, Settings::PlatformTicksPerSecond);
+}
+
+// -----------------------------------------------------------------------------
+
+template<class Transport, class Settings, class Platform, class Handler>
+inline Channel MidiInterface<Transport, Settings, Platform, Handler>::getInputChannel() const
 {
     return mInputChannel;
 }
@@ -1251,8 +1505,8 @@ inline Channel MidiInterface<Transport, Settings, Platform>::getInputChannel() c
  \param inChannel the channel value. Valid values are 1 to 16, MIDI_CHANNEL_OMNI
  if you want to listen to all channels, and MIDI_CHANNEL_OFF to disable input.
  */
-template<class Transport, class Settings, class Platform>
-inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::setInputChannel(Channel inChannel)
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::setInputChannel(Channel inChannel)
 {
     mInputChannel = inChannel;
 
@@ -1266,129 +1520,106 @@ inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Se
  This is a utility static method, used internally,
  made public so you can handle MidiTypes more easily.
  */
-template<class Transport, class Settings, class Platform>
-MidiType MidiInterface<Transport, Settings, Platform>::getTypeFromStatusByte(byte inStatus)
+template<class Transport, class Settings, class Platform, class Handler>
+MidiType MidiInterface<Transport, Settings, Platform, Handler>::getTypeFromStatusByte(byte inStatus)
 {
-    if ((inStatus  < 0x80) ||
-        (inStatus == Undefined_F4) ||
-        (inStatus == Undefined_F5) ||
-        (inStatus == Undefined_FD))
-        return InvalidType; // Data bytes and undefined.
-
-    if (inStatus < 0xf0)
-        // Channel message, remove channel nibble.
-        return MidiType(inStatus & 0xf0);
-
-    return MidiType(inStatus);
+    return MidiParser::getTypeFromStatusByte(inStatus);
 }
 
 /*! \brief Returns channel in the range 1-16
  */
-template<class Transport, class Settings, class Platform>
-inline Channel MidiInterface<Transport, Settings, Platform>::getChannelFromStatusByte(byte inStatus)
+template<class Transport, class Settings, class Platform, class Handler>
+inline Channel MidiInterface<Transport, Settings, Platform, Handler>::getChannelFromStatusByte(byte inStatus)
 {
-    return Channel((inStatus & 0x0f) + 1);
+    return MidiParser::getChannelFromStatusByte(inStatus);
 }
 
-template<class Transport, class Settings, class Platform>
-bool MidiInterface<Transport, Settings, Platform>::isChannelMessage(MidiType inType)
+template<class Transport, class Settings, class Platform, class Handler>
+bool MidiInterface<Transport, Settings, Platform, Handler>::isChannelMessage(MidiType inType)
 {
-    return (inType == NoteOff           ||
-            inType == NoteOn            ||
-            inType == ControlChange     ||
-            inType == AfterTouchPoly    ||
-            inType == AfterTouchChannel ||
-            inType == PitchBend         ||
-            inType == ProgramChange);
+    return MidiParser::isChannelMessage(inType);
 }
 
 // -----------------------------------------------------------------------------
 
+/*! \brief Attach a function and a user context to the given type.
+
+ The context pointer is passed back to the function along with the received
+ message, so several interfaces or objects can share the same function without
+ writing one global trampoline per instance.
+ \param inType        The type of message to bind.
+ \param fptr          The function to call, nullptr to unbind.
+ \param inContext     User data passed as first argument to the function.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::setHandle(MidiType inType, ContextCallback fptr, void* inContext)
+{
+    mHandler.setHandle(inType, fptr, inContext);
+
+    return *this;
+}
+
+/*! \brief Attach a function and a user context to a channel message type,
+ for messages received on the given channel only.
+
+ Channel-specific functions take precedence over the ones bound for all
+ channels, which are still called for the other channels.
+ Up to Settings::MaxChannelCallbacks channel-specific functions can be bound
+ (it must not be 0, which does not compile). When they are all in use, the
+ function is not bound: check it with hasChannelHandle, and unbind another
+ one to make room. The per-channel setHandle******** methods work the same.
+ \param inType        The type of channel message to bind (NoteOff to PitchBend).
+ \param inChannel     The channel to route (1 to 16).
+ \param fptr          The function to call, nullptr to unbind.
+ \param inContext     User data passed as first argument to the function.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::setHandle(MidiType inType, Channel inChannel, ContextCallback fptr, void* inContext)
+{
+    mHandler.setHandle(inType, inChannel, fptr, inContext);
+
+    return *this;
+}
+
 /*! \brief Detach an external function from the given type.
 
  Use this method to cancel the effects of setHandle********.
  \param inType        The type of message to unbind.
  When a message of this type is received, no function will be called.
  */
-template<class Transport, class Settings, class Platform>
-MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::disconnectCallbackFromType(MidiType inType)
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::disconnectCallbackFromType(MidiType inType)
 {
-    switch (inType)
-    {
-        case NoteOff:               mNoteOffCallback                = nullptr; break;
-        case NoteOn:                mNoteOnCallback                 = nullptr; break;
-        case AfterTouchPoly:        mAfterTouchPolyCallback         = nullptr; break;
-        case ControlChange:         mControlChangeCallback          = nullptr; break;
-        case ProgramChange:         mProgramChangeCallback          = nullptr; break;
-        case AfterTouchChannel:     mAfterTouchChannelCallback      = nullptr; break;
-        case PitchBend:             mPitchBendCallback              = nullptr; break;
-        case SystemExclusive:       mSystemExclusiveCallback        = nullptr; break;
-        case TimeCodeQuarterFrame:  mTimeCodeQuarterFrameCallback   = nullptr; break;
-        case SongPosition:          mSongPositionCallback           = nullptr; break;
-        case SongSelect:            mSongSelectCallback             = nullptr; break;
-        case TuneRequest:           mTuneRequestCallback            = nullptr; break;
-        case Clock:                 mClockCallback                  = nullptr; break;
-        case Start:                 mStartCallback                  = nullptr; break;
-        case Tick:                  mTickCallback                   = nullptr; break;
-        case Continue:              mContinueCallback               = nullptr; break;
-        case Stop:                  mStopCallback                   = nullptr; break;
-        case ActiveSensing:         mActiveSensingCallback          = nullptr; break;
-        case SystemReset:           mSystemResetCallback            = nullptr; break;
-        default:
-            break;
-    }
+    mHandler.disconnectCallbackFromType(inType);
 
     return *this;
 }
 
-/*! @} */ // End of doc group MIDI Callbacks
+/*! \brief Detach a channel-specific function from the given type.
 
-// Private - launch callback function based on received type.
-template<class Transport, class Settings, class Platform>
-void MidiInterface<Transport, Settings, Platform>::launchCallback()
+ Messages of this type received on this channel will then be passed to the
+ function bound for all channels, if any.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::disconnectCallbackFromType(MidiType inType, Channel inChannel)
 {
-    if (mMessageCallback != 0) mMessageCallback(mMessage);
+    mHandler.disconnectCallbackFromType(inType, inChannel);
 
-    // The order is mixed to allow frequent messages to trigger their callback faster.
-    switch (mMessage.type)
-    {
-            // Notes
-        case NoteOff:               if (mNoteOffCallback != nullptr)               mNoteOffCallback(mMessage.channel, mMessage.data1, mMessage.data2);   break;
-        case NoteOn:                if (mNoteOnCallback != nullptr)                mNoteOnCallback(mMessage.channel, mMessage.data1, mMessage.data2);    break;
-
-            // Real-time messages
-        case Clock:                 if (mClockCallback != nullptr)                 mClockCallback();           break;
-        case Start:                 if (mStartCallback != nullptr)                 mStartCallback();           break;
-        case Tick:                  if (mTickCallback != nullptr)                  mTickCallback();            break;
-        case Continue:              if (mContinueCallback != nullptr)              mContinueCallback();        break;
-        case Stop:                  if (mStopCallback != nullptr)                  mStopCallback();            break;
-        case ActiveSensing:         if (mActiveSensingCallback != nullptr)         mActiveSensingCallback();   break;
-
-            // Continuous controllers
-        case ControlChange:         if (mControlChangeCallback != nullptr)         mControlChangeCallback(mMessage.channel, mMessage.data1, mMessage.data2);    break;
-        case PitchBend:             if (mPitchBendCallback != nullptr)             mPitchBendCallback(mMessage.channel, (int)((mMessage.data1 & 0x7f) | ((mMessage.data2 & 0x7f) << 7)) + MIDI_PITCHBEND_MIN); break;
-        case AfterTouchPoly:        if (mAfterTouchPolyCallback != nullptr)        mAfterTouchPolyCallback(mMessage.channel, mMessage.data1, mMessage.data2);    break;
-        case AfterTouchChannel:     if (mAfterTouchChannelCallback != nullptr)     mAfterTouchChannelCallback(mMessage.channel, mMessage.data1);    break;
-
-        case ProgramChange:         if (mProgramChangeCallback != nullptr)         mProgramChangeCallback(mMessage.channel, mMessage.data1);    break;
-        case SystemExclusive:       if (mSystemExclusiveCallback != nullptr)       mSystemExclusiveCallback(mMessage.sysexArray, mMessage.getSysExSize());    break;
-
-            // Occasional messages
-        case TimeCodeQuarterFrame:  if (mTimeCodeQuarterFrameCallback != nullptr)  mTimeCodeQuarterFrameCallback(mMessage.data1);    break;
-        case SongPosition:          if (mSongPositionCallback != nullptr)          mSongPositionCallback(unsigned((mMessage.data1 & 0x7f) | ((mMessage.data2 & 0x7f) << 7)));    break;
-        case SongSelect:            if (mSongSelectCallback != nullptr)            mSongSelectCallback(mMessage.data1);    break;
-        case TuneRequest:           if (mTuneRequestCallback != nullptr)           mTuneRequestCallback();    break;
-
-        case SystemReset:           if (mSystemResetCallback != nullptr)           mSystemResetCallback();    break;
-
-        // LCOV_EXCL_START - Unreacheable code, but prevents unhandled case warning.
-        case InvalidType:
-        default:
-            break;
-        // LCOV_EXCL_STOP
-    }
+    return *this;
 }
 
+/*! \brief Check if a channel-specific function is bound to a type and channel.
+ \return false if none was bound, or if binding failed because all the
+ Settings::MaxChannelCallbacks channel-specific functions are in use.
+ */
+template<class Transport, class Settings, class Platform, class Handler>
+inline bool MidiInterface<Transport, Settings, Platform, Handler>::hasChannelHandle(MidiType inType, Channel inChannel) const
+{
+    return mHandler.hasChannelHandle(inType, inChannel);
+}
+
+/*! @} */ // End of doc group MIDI Callbacks
+
 /*! @} */ // End of doc group MIDI Input
 
 // -----------------------------------------------------------------------------
@@ -1404,8 +1635,8 @@ void MidiInterface<Transport, Settings, Platform>::launchCallback()
 
  @see Thru::Mode
  */
-template<class Transport, class Settings, class Platform>
-inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::setThruFilterMode(Thru::Mode inThruFilterMode)
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::setThruFilterMode(Thru::Mode inThruFilterMode)
 {
     mThruFilterMode = inThruFilterMode;
     mThruActivated  = mThruFilterMode != Thru::Off;
@@ -1413,20 +1644,20 @@ inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Se
     return *this;
 }
 
-template<class Transport, class Settings, class Platform>
-inline Thru::Mode MidiInterface<Transport, Settings, Platform>::getFilterMode() const
+template<class Transport, class Settings, class Platform, class Handler>
+inline Thru::Mode MidiInterface<Transport, Settings, Platform, Handler>::getFilterMode() const
 {
     return mThruFilterMode;
 }
 
-template<class Transport, class Settings, class Platform>
-inline bool MidiInterface<Transport, Settings, Platform>::getThruState() const
+template<class Transport, class Settings, class Platform, class Handler>
+inline bool MidiInterface<Transport, Settings, Platform, Handler>::getThruState() const
 {
     return mThruActivated;
 }
 
-template<class Transport, class Settings, class Platform>
-inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::turnThruOn(Thru::Mode inThruFilterMode)
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::turnThruOn(Thru::Mode inThruFilterMode)
 {
     mThruActivated = true;
     mThruFilterMode = inThruFilterMode;
@@ -1434,8 +1665,8 @@ inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Se
     return *this;
 }
 
-template<class Transport, class Settings, class Platform>
-inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Settings, Platform>::turnThruOff()
+template<class Transport, class Settings, class Platform, class Handler>
+inline MidiInterface<Transport, Settings, Platform, Handler>& MidiInterface<Transport, Settings, Platform, Handler>::turnThruOff()
 {
     mThruActivated = false;
     mThruFilterMode = Thru::Off;
@@ -1452,8 +1683,8 @@ inline MidiInterface<Transport, Settings, Platform>& MidiInterface<Transport, Se
 //   to output unless filter is set to Off.
 // - Channel messages are passed to the output whether their channel
 //   is matching the input channel and the filter setting
-template<class Transport, class Settings, class Platform>
-void MidiInterface<Transport, Settings, Platform>::thruFilter(Channel inChannel)
+template<class Transport, class Settings, class Platform, class Handler>
+void MidiInterface<Transport, Settings, Platform, Handler>::thruFilter(Channel inChannel)
 {
     // If the feature is disabled, don't do anything.
     if (!mThruActivated || (mThruFilterMode == Thru::Off))
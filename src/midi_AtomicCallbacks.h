@@ -0,0 +1,194 @@
+/*!
+ *  @file       midi_AtomicCallbacks.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Thread-safe callback handler for host builds
+ *  @author     Francois Best, lathoub
+ *  @date       19/10/26
+ *  @license    MIT - Copyright (c) 2015 Francois Best
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "midi_Callbacks.h"
+
+#ifndef ARDUINO
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Callback handler that can be reconfigured from another thread
+ (host builds only).
+
+ Callbacks are grouped in an immutable CallbackHandler, published
+ atomically: the thread calling MidiInterface::read always sees a complete
+ set of callbacks, and never takes a lock. Replaced sets are reclaimed once
+ the reading thread is done with them.
+ \code{.cpp}
+ typedef midi::AtomicCallbackHandler<midi::DefaultSettings> Handler;
+ midi::MidiInterface<Transport, midi::DefaultSettings, midi::DefaultPlatform, Handler> MIDI(transport);
+
+ // From the control thread:
+ MIDI.getHandler()->update([](Handler::CallbackSet& callbacks)
+ {
+     callbacks.setHandleNoteOn(handleNoteOn);
+     callbacks.setHandleNoteOff(handleNoteOff);
+ });
+ \endcode
+ A single thread may dispatch messages (ie: call read()) at a time, any
+ number of threads can update the callbacks.
+ */
+template<class Settings>
+class AtomicCallbackHandler : public EmptyHandler
+{
+public:
+    typedef CallbackHandler<Settings> CallbackSet;
+    typedef typename CallbackSet::MidiMessage MidiMessage;
+
+public:
+    inline AtomicCallbackHandler()
+        : mCurrent(new CallbackSet())
+        , mReaderSequence(0)
+    {
+    }
+
+    inline ~AtomicCallbackHandler()
+    {
+        delete mCurrent.load();
+        for (const Retired& retired : mRetired)
+            delete retired.mSet;
+    }
+
+    AtomicCallbackHandler(const AtomicCallbackHandler&) = delete;
+    AtomicCallbackHandler& operator=(const AtomicCallbackHandler&) = delete;
+
+public:
+    /*! \brief Get a copy of the current callbacks, to be modified and published.
+     */
+    inline std::unique_ptr<CallbackSet> copy() const
+    {
+        std::lock_guard<std::mutex> lock(mUpdateMutex);
+        return std::unique_ptr<CallbackSet>(new CallbackSet(*mCurrent.load()));
+    }
+
+    /*! \brief Replace the current callbacks.
+     The previous set is reclaimed when it is no longer in use.
+     */
+    inline void publish(std::unique_ptr<const CallbackSet> inSet)
+    {
+        std::lock_guard<std::mutex> lock(mUpdateMutex);
+        swap(inSet.release());
+    }
+
+    /*! \brief Modify a copy of the current callbacks and publish it.
+     \param inEdit Function called with the CallbackSet to modify.
+     */
+    template<class Edit>
+    inline void update(Edit inEdit)
+    {
+        std::lock_guard<std::mutex> lock(mUpdateMutex);
+        CallbackSet* set = new CallbackSet(*mCurrent.load());
+        inEdit(*set);
+        swap(set);
+    }
+
+    /*! \brief Free the replaced sets that are no longer in use.
+     This is also done on each update.
+     \return The number of sets still waiting to be reclaimed.
+     */
+    inline unsigned reclaim()
+    {
+        std::lock_guard<std::mutex> lock(mUpdateMutex);
+        return collect();
+    }
+
+public:
+    inline void onMessage(const MidiMessage& inMessage)
+    {
+        enter();
+        mCurrent.load()->onMessage(inMessage);
+        leave();
+    }
+    inline void onError(int8_t inError)
+    {
+        enter();
+        mCurrent.load()->onError(inError);
+        leave();
+    }
+
+private:
+    // The sequence is odd while the reading thread dispatches a message.
+    inline void enter()
+    {
+        mReaderSequence.fetch_add(1);
+    }
+    inline void leave()
+    {
+        mReaderSequence.fetch_add(1, std::memory_order_release);
+    }
+
+    inline void swap(const CallbackSet* inSet)
+    {
+        Retired retired;
+        retired.mSet = mCurrent.exchange(inSet);
+
+        // If the reader is not dispatching, it will load the new set.
+        // Otherwise, the old set can be freed once the sequence has moved on.
+        retired.mSequence = mReaderSequence.load();
+        mRetired.push_back(retired);
+        collect();
+    }
+
+    inline unsigned collect()
+    {
+        const unsigned sequence = mReaderSequence.load(std::memory_order_acquire);
+        size_t kept = 0;
+        for (size_t i = 0; i < mRetired.size(); ++i)
+        {
+            const Retired& retired = mRetired[i];
+            if ((retired.mSequence & 1) == 0 || retired.mSequence != sequence)
+                delete retired.mSet;
+            else
+                mRetired[kept++] = retired;
+        }
+        mRetired.resize(kept);
+        return unsigned(kept);
+    }
+
+private:
+    struct Retired
+    {
+        const CallbackSet* mSet;
+        unsigned mSequence;
+    };
+
+    std::atomic<const CallbackSet*> mCurrent;
+    std::atomic<unsigned> mReaderSequence;
+    mutable std::mutex mUpdateMutex;
+    std::vector<Retired> mRetired;
+};
+
+END_MIDI_NAMESPACE
+
+#endif // ARDUINO
@@ -0,0 +1,452 @@
+/*!
+ *  @file       midi_Callbacks.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Input handlers
+ *  @author     Francois Best, lathoub
+ *  @date       19/10/26
+ *  @license    MIT - Copyright (c) 2015 Francois Best
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "midi_Defs.h"
+#include "midi_Message.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Input handler with empty hooks, to be used as a base class for
+ static handlers.
+
+ MidiInterface calls the hooks of its Handler type directly, so hooks that you
+ don't hide in your subclass are empty inline functions and compile away.
+ Hooks can be static or member functions. Eg:
+ \code{.cpp}
+ struct MyHandler : public MIDI_NAMESPACE::EmptyHandler
+ {
+    static void onNoteOn(byte channel, byte note, byte velocity);
+ };
+
+ MIDI_NAMESPACE::SerialMIDI<HardwareSerial> serialMIDI(Serial);
+ MIDI_NAMESPACE::MidiInterface<MIDI_NAMESPACE::SerialMIDI<HardwareSerial>,
+                               MIDI_NAMESPACE::DefaultSettings,
+                               MIDI_NAMESPACE::DefaultPlatform,
+                               MyHandler> MIDI(serialMIDI);
+ \endcode
+ Member hooks are called on the instance returned by MidiInterface::getHandler.
+ */
+struct EmptyHandler
+{
+    template<class MidiMessage>
+    static inline void onMessage(const MidiMessage&) {}
+    static inline void onError(int8_t) {}
+    static inline void onNoteOff(Channel, byte, byte) {}
+    static inline void onNoteOn(Channel, byte, byte) {}
+    static inline void onAfterTouchPoly(Channel, byte, byte) {}
+    static inline void onControlChange(Channel, byte, byte) {}
+    static inline void onProgramChange(Channel, byte) {}
+    static inline void onAfterTouchChannel(Channel, byte) {}
+    static inline void onPitchBend(Channel, int) {}
+    static inline void onSystemExclusive(byte*, unsigned) {}
+    static inline void onTimeCodeQuarterFrame(byte) {}
+    static inline void onSongPosition(unsigned) {}
+    static inline void onSongSelect(byte) {}
+    static inline void onTuneRequest() {}
+    static inline void onClock() {}
+    static inline void onStart() {}
+    static inline void onTick() {}
+    static inline void onContinue() {}
+    static inline void onStop() {}
+    static inline void onActiveSensing() {}
+    static inline void onSystemReset() {}
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Channel-specific delegates, stored in a fixed pool of Size entries.
+
+ A bit mask per channel message type tells which channels have a specific
+ delegate, so messages on other channels skip the pool lookup entirely.
+ */
+template<class Delegate, unsigned Size>
+class ChannelDelegates
+{
+public:
+    static const unsigned sNumTypes = 7; // NoteOff to PitchBend
+
+public:
+    inline ChannelDelegates()
+    {
+        for (unsigned i = 0; i < sNumTypes; ++i)
+            mChannelMasks[i] = 0;
+        for (unsigned i = 0; i < Size; ++i)
+            mEntries[i].channel = 0;
+    }
+
+    inline const Delegate* find(unsigned inTypeIndex, Channel inChannel) const
+    {
+        if (inChannel == 0 || inChannel > 16)
+            return nullptr;
+        if ((mChannelMasks[inTypeIndex] & getChannelBit(inChannel)) == 0)
+            return nullptr;
+
+        for (unsigned i = 0; i < Size; ++i)
+        {
+            if (mEntries[i].channel == inChannel && mEntries[i].typeIndex == inTypeIndex)
+                return &mEntries[i].delegate;
+        }
+        return nullptr; // LCOV_EXCL_LINE - Masks and entries are kept in sync.
+    }
+
+    /*! Bind or unbind (with an empty delegate) a channel-specific delegate.
+     Binding is ignored when the pool is full.
+     */
+    inline void set(unsigned inTypeIndex, Channel inChannel, const Delegate& inDelegate)
+    {
+        if (inChannel == 0 || inChannel > 16)
+            return;
+
+        Entry* freeEntry = nullptr;
+        for (unsigned i = 0; i < Size; ++i)
+        {
+            Entry& entry = mEntries[i];
+            if (entry.channel == inChannel && entry.typeIndex == inTypeIndex)
+            {
+                if (inDelegate.isBound())
+                {
+                    entry.delegate = inDelegate;
+                }
+                else
+                {
+                    entry.channel = 0;
+                    mChannelMasks[inTypeIndex] &= uint16_t(~getChannelBit(inChannel));
+                }
+                return;
+            }
+            if (entry.channel == 0 && freeEntry == nullptr)
+                freeEntry = &entry;
+        }
+
+        if (inDelegate.isBound() && freeEntry != nullptr)
+        {
+            freeEntry->delegate  = inDelegate;
+            freeEntry->typeIndex = byte(inTypeIndex);
+            freeEntry->channel   = inChannel;
+            mChannelMasks[inTypeIndex] |= getChannelBit(inChannel);
+        }
+    }
+
+private:
+    static inline uint16_t getChannelBit(Channel inChannel)
+    {
+        return uint16_t(1u << ((inChannel - 1) & 0x0f));
+    }
+
+    struct Entry
+    {
+        Delegate delegate;
+        byte typeIndex;
+        Channel channel; // 0 when the entry is free
+    };
+
+    uint16_t mChannelMasks[sNumTypes];
+    Entry mEntries[Size];
+};
+
+template<class Delegate>
+class ChannelDelegates<Delegate, 0>
+{
+public:
+    static const unsigned sNumTypes = 7;
+
+public:
+    inline const Delegate* find(unsigned, Channel) const { return nullptr; }
+    inline void set(unsigned, Channel, const Delegate&) {}
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Default input handler, calling the functions registered with the
+ MidiInterface::setHandle******** methods.
+
+ Callbacks are stored in a table indexed by message type, each entry being a
+ function pointer, a user context pointer and a trampoline unpacking the
+ message for the type of the function. Dispatching a message costs one table
+ lookup and a direct call to the trampoline, made from the onMessage hook (the
+ typed hooks are left empty and compile away).
+ Plain callbacks (eg: NoteOnCallback) are stored with their own type, so no
+ function pointer is ever converted to another type.
+
+ Channel messages can also be routed to channel-specific callbacks, looked up
+ before falling back to the callback for all channels. Up to
+ Settings::MaxChannelCallbacks of them can be bound at once.
+ */
+template<class Settings>
+class CallbackHandler : public EmptyHandler
+{
+public:
+    typedef Message<Settings::SysExMaxSize, typename Settings::SysExPool> MidiMessage;
+    typedef void (*MessageCallback)(const MidiMessage& message);
+    typedef void (*ContextCallback)(void* context, const MidiMessage& message);
+
+public:
+    inline void setHandleMessage(MessageCallback fptr) { mMessageCallback.set(fptr); }
+    inline void setHandleMessage(ContextCallback fptr, void* inContext) { mMessageCallback.set(fptr, inContext); }
+    inline void setHandleError(ErrorCallback fptr) { mErrorCallback = fptr; }
+    inline void setHandleNoteOff(NoteOffCallback fptr) { set(NoteOff, fptr); }
+    inline void setHandleNoteOn(NoteOnCallback fptr) { set(NoteOn, fptr); }
+    inline void setHandleAfterTouchPoly(AfterTouchPolyCallback fptr) { set(AfterTouchPoly, fptr); }
+    inline void setHandleControlChange(ControlChangeCallback fptr) { set(ControlChange, fptr); }
+    inline void setHandleProgramChange(ProgramChangeCallback fptr) { set(ProgramChange, fptr); }
+    inline void setHandleAfterTouchChannel(AfterTouchChannelCallback fptr) { set(AfterTouchChannel, fptr); }
+    inline void setHandlePitchBend(PitchBendCallback fptr) { set(PitchBend, fptr); }
+    inline void setHandleSystemExclusive(SystemExclusiveCallback fptr) { set(SystemExclusive, fptr); }
+    inline void setHandleTimeCodeQuarterFrame(TimeCodeQuarterFrameCallback fptr) { set(TimeCodeQuarterFrame, fptr); }
+    inline void setHandleSongPosition(SongPositionCallback fptr) { set(SongPosition, fptr); }
+    inline void setHandleSongSelect(SongSelectCallback fptr) { set(SongSelect, fptr); }
+    inline void setHandleTuneRequest(TuneRequestCallback fptr) { set(TuneRequest, fptr); }
+    inline void setHandleClock(ClockCallback fptr) { set(Clock, fptr); }
+    inline void setHandleStart(StartCallback fptr) { set(Start, fptr); }
+    inline void setHandleTick(TickCallback fptr) { set(Tick, fptr); }
+    inline void setHandleContinue(ContinueCallback fptr) { set(Continue, fptr); }
+    inline void setHandleStop(StopCallback fptr) { set(Stop, fptr); }
+    inline void setHandleActiveSensing(ActiveSensingCallback fptr) { set(ActiveSensing, fptr); }
+    inline void setHandleSystemReset(SystemResetCallback fptr) { set(SystemReset, fptr); }
+
+    /*! \brief Bind a function and a user context to a message type.
+     The context is passed back to the function along with the message,
+     so several interfaces or objects can share the same function.
+     */
+    inline void setHandle(MidiType inType, ContextCallback fptr, void* inContext)
+    {
+        if (isDispatchable(inType))
+            mCallbacks[getIndex(inType)].set(fptr, inContext);
+    }
+
+    /*! \brief Bind a function and a user context to a channel message type,
+     for messages received on the given channel only.
+     */
+    inline void setHandle(MidiType inType, Channel inChannel, ContextCallback fptr, void* inContext)
+    {
+        static_assert(Settings::MaxChannelCallbacks > 0, "Channel-specific callbacks require Settings::MaxChannelCallbacks");
+
+        if (isChannelType(inType))
+        {
+            Delegate delegate;
+            delegate.set(fptr, inContext);
+            mChannelCallbacks.set(getIndex(inType), inChannel, delegate);
+        }
+    }
+
+    inline void setHandleNoteOff(Channel inChannel, NoteOffCallback fptr) { set(NoteOff, inChannel, fptr); }
+    inline void setHandleNoteOn(Channel inChannel, NoteOnCallback fptr) { set(NoteOn, inChannel, fptr); }
+    inline void setHandleAfterTouchPoly(Channel inChannel, AfterTouchPolyCallback fptr) { set(AfterTouchPoly, inChannel, fptr); }
+    inline void setHandleControlChange(Channel inChannel, ControlChangeCallback fptr) { set(ControlChange, inChannel, fptr); }
+    inline void setHandleProgramChange(Channel inChannel, ProgramChangeCallback fptr) { set(ProgramChange, inChannel, fptr); }
+    inline void setHandleAfterTouchChannel(Channel inChannel, AfterTouchChannelCallback fptr) { set(AfterTouchChannel, inChannel, fptr); }
+    inline void setHandlePitchBend(Channel inChannel, PitchBendCallback fptr) { set(PitchBend, inChannel, fptr); }
+
+    /*! \brief True if a channel-specific function is bound to this type
+     and channel. Bindings are dropped when the pool is full.
+     */
+    inline bool hasChannelHandle(MidiType inType, Channel inChannel) const
+    {
+        return isChannelType(inType) &&
+               mChannelCallbacks.find(getIndex(inType), inChannel) != nullptr;
+    }
+
+    inline void disconnectCallbackFromType(MidiType inType)
+    {
+        setHandle(inType, nullptr, nullptr);
+    }
+    inline void disconnectCallbackFromType(MidiType inType, Channel inChannel)
+    {
+        setHandle(inType, inChannel, nullptr, nullptr);
+    }
+
+public:
+    inline void onMessage(const MidiMessage& inMessage) const
+    {
+        mMessageCallback.invoke(inMessage);
+
+        const unsigned index = getIndex(inMessage.type);
+        if (index < ChannelCallbacks::sNumTypes)
+        {
+            const Delegate* channelDelegate = mChannelCallbacks.find(index, inMessage.channel);
+            if (channelDelegate != nullptr)
+            {
+                channelDelegate->invoke(inMessage);
+                return;
+            }
+        }
+        mCallbacks[index].invoke(inMessage);
+    }
+    inline void onError(int8_t inError) const
+    {
+        if (mErrorCallback != nullptr)
+            mErrorCallback(inError);
+    }
+
+private:
+    // A function of any of the callback types, along with a trampoline
+    // unpacking the message for that type, called directly on dispatch.
+    class Delegate
+    {
+    public:
+        inline Delegate()
+            : mContext(nullptr)
+            , mTrampoline(nullptr)
+        {
+            mFunction.withContext = nullptr;
+        }
+
+        inline void set(ContextCallback fptr, void* inContext)
+        {
+            mFunction.withContext = fptr;
+            mContext = inContext;
+            mTrampoline = fptr != nullptr ? &invokeWithContext : nullptr;
+        }
+        inline void set(MessageCallback fptr)           { mFunction.message         = fptr; bind(fptr != nullptr, &invokeMessage); }
+        inline void set(NoteOnCallback fptr)            { mFunction.channelData2    = fptr; bind(fptr != nullptr, &invokeChannelData2); }
+        inline void set(ProgramChangeCallback fptr)     { mFunction.channelData1    = fptr; bind(fptr != nullptr, &invokeChannelData1); }
+        inline void set(PitchBendCallback fptr)         { mFunction.pitchBend       = fptr; bind(fptr != nullptr, &invokePitchBend); }
+        inline void set(SystemExclusiveCallback fptr)   { mFunction.systemExclusive = fptr; bind(fptr != nullptr, &invokeSystemExclusive); }
+        inline void set(SongSelectCallback fptr)        { mFunction.data1           = fptr; bind(fptr != nullptr, &invokeData1); }
+        inline void set(SongPositionCallback fptr)      { mFunction.songPosition    = fptr; bind(fptr != nullptr, &invokeSongPosition); }
+        inline void set(ClockCallback fptr)             { mFunction.none            = fptr; bind(fptr != nullptr, &invokeVoid); }
+
+        inline void invoke(const MidiMessage& inMessage) const
+        {
+            if (mTrampoline != nullptr)
+                mTrampoline(*this, inMessage);
+        }
+        inline bool isBound() const
+        {
+            return mTrampoline != nullptr;
+        }
+
+    private:
+        typedef void (*Trampoline)(const Delegate& inDelegate, const MidiMessage& inMessage);
+
+        inline void bind(bool inBound, Trampoline inTrampoline)
+        {
+            mContext = nullptr;
+            mTrampoline = inBound ? inTrampoline : nullptr;
+        }
+
+        // Trampolines unpacking messages for each callback type.
+        static void invokeWithContext(const Delegate& inDelegate, const MidiMessage& inMessage)
+        {
+            inDelegate.mFunction.withContext(inDelegate.mContext, inMessage);
+        }
+        static void invokeMessage(const Delegate& inDelegate, const MidiMessage& inMessage)
+        {
+            inDelegate.mFunction.message(inMessage);
+        }
+        static void invokeChannelData2(const Delegate& inDelegate, const MidiMessage& inMessage)
+        {
+            inDelegate.mFunction.channelData2(inMessage.channel, inMessage.data1, inMessage.data2);
+        }
+        static void invokeChannelData1(const Delegate& inDelegate, const MidiMessage& inMessage)
+        {
+            inDelegate.mFunction.channelData1(inMessage.channel, inMessage.data1);
+        }
+        static void invokePitchBend(const Delegate& inDelegate, const MidiMessage& inMessage)
+        {
+            inDelegate.mFunction.pitchBend(inMessage.channel, (int)((inMessage.data1 & 0x7f) | ((inMessage.data2 & 0x7f) << 7)) + MIDI_PITCHBEND_MIN);
+        }
+        static void invokeSystemExclusive(const Delegate& inDelegate, const MidiMessage& inMessage)
+        {
+            inDelegate.mFunction.systemExclusive(const_cast<byte*>(inMessage.sysexArray), inMessage.getSysExSize());
+        }
+        static void invokeData1(const Delegate& inDelegate, const MidiMessage& inMessage)
+        {
+            inDelegate.mFunction.data1(inMessage.data1);
+        }
+        static void invokeSongPosition(const Delegate& inDelegate, const MidiMessage& inMessage)
+        {
+            inDelegate.mFunction.songPosition(unsigned((inMessage.data1 & 0x7f) | ((inMessage.data2 & 0x7f) << 7)));
+        }
+        static void invokeVoid(const Delegate& inDelegate, const MidiMessage&)
+        {
+            inDelegate.mFunction.none();
+        }
+
+        union Function
+        {
+            ContextCallback         withContext;
+            MessageCallback         message;
+            NoteOnCallback          channelData2;
+            ProgramChangeCallback   channelData1;
+            PitchBendCallback       pitchBend;
+            SystemExclusiveCallback systemExclusive;
+            SongSelectCallback      data1;
+            SongPositionCallback    songPosition;
+            ClockCallback           none;
+        };
+
+        Function mFunction;
+        void* mContext;
+        Trampoline mTrampoline;
+    };
+
+    // Channel messages use one entry per status nibble (0x8n to 0xEn),
+    // System messages one entry per status byte (0xF0 to 0xFF).
+    static const unsigned sNumCallbacks = 7 + 16;
+
+    typedef ChannelDelegates<Delegate, Settings::MaxChannelCallbacks> ChannelCallbacks;
+
+    static inline bool isDispatchable(MidiType inType)
+    {
+        return inType >= NoteOff;
+    }
+    static inline bool isChannelType(MidiType inType)
+    {
+        return inType >= NoteOff && inType <= PitchBend;
+    }
+    static inline unsigned getIndex(MidiType inType)
+    {
+        return inType < SystemExclusive ? unsigned(inType >> 4) - 8
+                                        : unsigned(inType - SystemExclusive) + 7;
+    }
+
+    template<typename Callback>
+    inline void set(MidiType inType, Callback fptr)
+    {
+        mCallbacks[getIndex(inType)].set(fptr);
+    }
+    template<typename Callback>
+    inline void set(MidiType inType, Channel inChannel, Callback fptr)
+    {
+        static_assert(Settings::MaxChannelCallbacks > 0, "Channel-specific callbacks require Settings::MaxChannelCallbacks");
+
+        Delegate delegate;
+        delegate.set(fptr);
+        mChannelCallbacks.set(getIndex(inType), inChannel, delegate);
+    }
+
+private:
+    Delegate mMessageCallback;
+    Delegate mCallbacks[sNumCallbacks];
+    ChannelCallbacks mChannelCallbacks;
+    ErrorCallback mErrorCallback = nullptr;
+};
+
+END_MIDI_NAMESPACE
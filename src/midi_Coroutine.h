@@ -0,0 +1,230 @@
+/*!
+ *  @file       midi_Coroutine.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Coroutine input for host builds
+ *  @author     Francois Best, lathoub
+ *  @date       19/10/26
+ *  @license    MIT - Copyright (c) 2015 Francois Best
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "midi_Defs.h"
+
+#if !defined(ARDUINO) && defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>) && __has_include(<poll.h>)
+#define MIDI_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifdef MIDI_HAS_COROUTINES
+
+#include <coroutine>
+#include <exception>
+#include <vector>
+#include <poll.h>
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Minimal single-threaded executor, resuming coroutines waiting
+ on MidiInterface::next when their transport's file descriptor becomes
+ readable, or when it is hung up or in error (the waiter is then closed).
+
+ Run one executor per thread, each serving any number of interfaces:
+ \code{.cpp}
+ midi::DetachedTask bridge(Midi& input, Midi& output, midi::PollExecutor& executor)
+ {
+     for (;;)
+     {
+         const auto message = co_await input.next(executor);
+         output.send(message);
+     }
+ }
+ \endcode
+ */
+class PollExecutor
+{
+public:
+    /*! \brief A coroutine waiting on a file descriptor.
+     poll() is called when the descriptor is readable, the coroutine is
+     resumed when it returns true. When the descriptor is hung up or in error
+     and no more can be read, mClosed is set and the coroutine is resumed.
+     */
+    struct Waiter
+    {
+        virtual bool poll() = 0;
+
+        std::coroutine_handle<> mHandle;
+        int mFileDescriptor = -1;
+        bool mClosed = false;
+
+    protected:
+        ~Waiter() = default;
+    };
+
+public:
+    inline void watch(Waiter& inWaiter)
+    {
+        mWaiters.push_back(&inWaiter);
+    }
+
+    inline bool empty() const
+    {
+        return mWaiters.empty();
+    }
+
+    /*! \brief Wait for readable descriptors and resume the matching coroutines.
+     \param inTimeoutMs Maximum time to wait, -1 to wait forever, 0 to return
+     immediately.
+     \return The number of resumed coroutines.
+     */
+    inline unsigned runOnce(int inTimeoutMs = -1)
+    {
+        if (mWaiters.empty())
+            return 0;
+
+        mFds.resize(mWaiters.size());
+        for (size_t i = 0; i < mWaiters.size(); ++i)
+        {
+            mFds[i].fd      = mWaiters[i]->mFileDescriptor;
+            mFds[i].events  = POLLIN;
+            mFds[i].revents = 0;
+        }
+
+        if (::poll(mFds.data(), mFds.size(), inTimeoutMs) <= 0)
+            return 0;
+
+        // Collect ready waiters first: resumed coroutines may watch again.
+        mReady.clear();
+        size_t kept = 0;
+        for (size_t i = 0; i < mWaiters.size(); ++i)
+        {
+            Waiter* waiter = mWaiters[i];
+            const short events = mFds[i].revents;
+            if ((events & POLLIN) && waiter->poll())
+            {
+                mReady.push_back(waiter->mHandle);
+            }
+            else if (events & (POLLHUP | POLLERR | POLLNVAL))
+            {
+                waiter->mClosed = true;
+                mReady.push_back(waiter->mHandle);
+            }
+            else
+            {
+                mWaiters[kept++] = waiter;
+            }
+        }
+        mWaiters.resize(kept);
+
+        const unsigned resumed = static_cast<unsigned>(mReady.size());
+        for (unsigned i = 0; i < resumed; ++i)
+            mReady[i].resume();
+        return resumed;
+    }
+
+    /*! \brief Serve waiting coroutines until none is left.
+     */
+    inline void run()
+    {
+        while (!mWaiters.empty())
+            runOnce();
+    }
+
+private:
+    std::vector<Waiter*> mWaiters;
+    std::vector<pollfd> mFds;
+    std::vector<std::coroutine_handle<>> mReady;
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Eagerly started, fire-and-forget coroutine type.
+ */
+struct DetachedTask
+{
+    struct promise_type
+    {
+        DetachedTask get_return_object() { return DetachedTask(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Awaitable returned by MidiInterface::next.
+ Completes immediately if a message can be parsed from the bytes already
+ available, otherwise suspends until the transport is readable and a
+ complete message has been received.
+ The transport must provide `int getFileDescriptor()`.
+ If the descriptor is hung up or in error before a complete message is
+ received, the returned message is not valid (see Message::valid).
+ */
+template<class Interface>
+class MessageAwaiter : public PollExecutor::Waiter
+{
+public:
+    inline MessageAwaiter(Interface& inMidi, PollExecutor& inExecutor)
+        : mMidi(inMidi)
+        , mExecutor(inExecutor)
+    {
+    }
+
+    inline bool await_ready()
+    {
+        return poll();
+    }
+
+    inline void await_suspend(std::coroutine_handle<> inHandle)
+    {
+        mHandle = inHandle;
+        mFileDescriptor = mMidi.getTransport()->getFileDescriptor();
+        mExecutor.watch(*this);
+    }
+
+    inline typename Interface::MidiMessage await_resume() const
+    {
+        if (mClosed)
+            return typename Interface::MidiMessage();
+        return mMidi.mMessage;
+    }
+
+    bool poll() override
+    {
+        while (mMidi.getTransport()->available())
+        {
+            if (mMidi.read())
+                return true;
+        }
+        return false;
+    }
+
+private:
+    Interface& mMidi;
+    PollExecutor& mExecutor;
+};
+
+END_MIDI_NAMESPACE
+
+#endif // MIDI_HAS_COROUTINES
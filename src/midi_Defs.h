@@ -58,6 +58,16 @@ typedef byte DataByte;
 typedef byte Channel;
 typedef byte FilterMode;
 
+/*! \brief Narrowest unsigned type holding values up to Max,
+ used for sizes and indexes in arrays of Max elements.
+ */
+template<unsigned long Max, int Width = (Max <= 0xff ? 1 : Max <= 0xffff ? 2 : 4)>
+struct SizeType                 { typedef uint32_t type; };
+template<unsigned long Max>
+struct SizeType<Max, 1>         { typedef uint8_t type; };
+template<unsigned long Max>
+struct SizeType<Max, 2>         { typedef uint16_t type; };
+
 // -----------------------------------------------------------------------------
 // Errors
 static const uint8_t ErrorParse = 0;
@@ -0,0 +1,161 @@
+/*!
+ *  @file       midi_EventBlock.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Block-based event delivery
+ *  @author     Francois Best, lathoub
+ *  @date       19/10/26
+ *  @license    MIT - Copyright (c) 2015 Francois Best
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "midi_Defs.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief A compact received event, as delivered by MidiInterface::takeBlock.
+ */
+struct BlockEvent
+{
+    /*! Position of the event in the audio block, in samples.
+     \n While the event is waiting in the interface, this holds the
+     Platform::now() time of its reception.
+     */
+    unsigned long offset;
+
+    MidiType type;      ///< The type of the event (see MidiType).
+    Channel channel;    ///< Channel, 1 to 16 for channel messages, 0 otherwise.
+    DataByte data1;     ///< The first data byte.
+    DataByte data2;     ///< The second data byte (0 if not applicable).
+};
+
+/*! \brief A contiguous span of events, sorted by offset.
+ It points into the interface's storage, and remains valid until the next
+ call to MidiInterface::read.
+ */
+struct EventBlock
+{
+    const BlockEvent* events;
+    unsigned size;
+
+    inline const BlockEvent* begin() const { return events; }
+    inline const BlockEvent* end() const { return events + size; }
+    inline const BlockEvent& operator[](unsigned inIndex) const { return events[inIndex]; }
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Fixed-capacity storage for events waiting to be taken as a block.
+ Events received when the storage is full are dropped.
+ */
+template<unsigned Capacity>
+class EventBlockQueue
+{
+public:
+    inline EventBlockQueue()
+        : mSize(0)
+        , mTaken(false)
+    {
+    }
+
+public:
+    inline void push(unsigned long inTime,
+                     MidiType inType,
+                     Channel inChannel,
+                     DataByte inData1,
+                     DataByte inData2)
+    {
+        if (mTaken)
+        {
+            // The previous block has been consumed.
+            mSize  = 0;
+            mTaken = false;
+        }
+        if (mSize >= Capacity)
+            return;
+
+        BlockEvent& event = mEvents[mSize++];
+        event.offset  = inTime;
+        event.type    = inType;
+        event.channel = inChannel;
+        event.data1   = inData1;
+        event.data2   = inData2;
+    }
+
+    inline EventBlock take(unsigned long inBlockStartTime,
+                           unsigned long inSampleRate,
+                           unsigned long inTicksPerSecond)
+    {
+        if (mTaken)
+            mSize = 0;
+
+        for (unsigned i = 0; i < mSize; ++i)
+            mEvents[i].offset = toSamples(mEvents[i].offset - inBlockStartTime,
+                                          inSampleRate, inTicksPerSecond);
+        mTaken = true;
+
+        EventBlock block;
+        block.events = mEvents;
+        block.size   = mSize;
+        return block;
+    }
+
+private:
+    // The elapsed time is read as signed, so that events received just before
+    // the block start (or before Platform::now() wrapped around) land at 0.
+    static inline unsigned long toSamples(unsigned long inElapsed,
+                                          unsigned long inSampleRate,
+                                          unsigned long inTicksPerSecond)
+    {
+        const long elapsed = long(inElapsed);
+        if (elapsed <= 0 || inTicksPerSecond == 0)
+            return 0;
+
+        const uint64_t maxOffset = (unsigned long)(-1);
+        const uint64_t ticks = uint64_t(elapsed);
+        if (inSampleRate != 0 && ticks > (uint64_t(-1) / inSampleRate))
+            return (unsigned long)maxOffset;
+
+        const uint64_t samples = (ticks * inSampleRate) / inTicksPerSecond;
+        return (unsigned long)(samples < maxOffset ? samples : maxOffset);
+    }
+
+private:
+    BlockEvent mEvents[Capacity];
+    unsigned mSize;
+    bool mTaken;
+};
+
+template<>
+class EventBlockQueue<0>
+{
+public:
+    inline void push(unsigned long, MidiType, Channel, DataByte, DataByte) {}
+    inline EventBlock take(unsigned long, unsigned long, unsigned long)
+    {
+        EventBlock block;
+        block.events = nullptr;
+        block.size   = 0;
+        return block;
+    }
+};
+
+END_MIDI_NAMESPACE
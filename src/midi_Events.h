@@ -0,0 +1,203 @@
+/*!
+ *  @file       midi_Events.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Typed events for visitors
+ *  @author     Francois Best, lathoub
+ *  @date       19/10/26
+ *  @license    MIT - Copyright (c) 2015 Francois Best
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "midi_Defs.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \defgroup events Typed events
+ Events passed to visitors by visit() and MidiInterface::read(Visitor&).
+ @{
+ */
+
+struct NoteOffEvent             { Channel channel; DataByte note; DataByte velocity; };
+struct NoteOnEvent              { Channel channel; DataByte note; DataByte velocity; };
+struct AfterTouchPolyEvent      { Channel channel; DataByte note; DataByte pressure; };
+struct ControlChangeEvent       { Channel channel; DataByte number; DataByte value; };
+struct ProgramChangeEvent       { Channel channel; DataByte number; };
+struct AfterTouchChannelEvent   { Channel channel; DataByte pressure; };
+struct PitchBendEvent           { Channel channel; int value; };
+struct SystemExclusiveEvent     { const byte* array; unsigned size; };
+struct TimeCodeQuarterFrameEvent{ DataByte data; };
+struct SongPositionEvent        { unsigned beats; };
+struct SongSelectEvent          { DataByte songNumber; };
+struct TuneRequestEvent         {};
+struct ClockEvent               {};
+struct StartEvent               {};
+struct TickEvent                {};
+struct ContinueEvent            {};
+struct StopEvent                {};
+struct ActiveSensingEvent       {};
+struct SystemResetEvent         {};
+
+/*! @} */ // End of doc group Typed events
+
+// -----------------------------------------------------------------------------
+
+// Calls the visitor with the event if it has a matching overload,
+// does nothing otherwise.
+struct EventInvoker
+{
+    template<class Visitor, class Event>
+    static inline auto invoke(Visitor& inVisitor, const Event& inEvent, int)
+        -> decltype(inVisitor(inEvent), void())
+    {
+        inVisitor(inEvent);
+    }
+
+    template<class Visitor, class Event>
+    static inline void invoke(Visitor&, const Event&, long)
+    {
+    }
+};
+
+template<class Visitor, class Event>
+inline void invokeVisitor(Visitor& inVisitor, const Event& inEvent)
+{
+    EventInvoker::invoke(inVisitor, inEvent, 0);
+}
+
+/*! \brief Pass a message to a visitor, as a typed event.
+
+ The visitor is called with the event matching the message type
+ (eg: NoteOnEvent), chosen by overload resolution. Events the visitor has no
+ overload for are ignored. Functors and lambdas are called directly and can
+ be inlined, eg:
+ \code{.cpp}
+ struct Synth
+ {
+     void operator()(const midi::NoteOnEvent& event)  { noteOn(event.note); }
+     void operator()(const midi::NoteOffEvent& event) { noteOff(event.note); }
+ };
+ \endcode
+ */
+template<class MidiMessage, class Visitor>
+inline void visit(const MidiMessage& inMessage, Visitor& inVisitor)
+{
+    switch (inMessage.type)
+    {
+        case NoteOff:
+        {
+            const NoteOffEvent event = { inMessage.channel, inMessage.data1, inMessage.data2 };
+            invokeVisitor(inVisitor, event);
+            break;
+        }
+        case NoteOn:
+        {
+            const NoteOnEvent event = { inMessage.channel, inMessage.data1, inMessage.data2 };
+            invokeVisitor(inVisitor, event);
+            break;
+        }
+        case AfterTouchPoly:
+        {
+            const AfterTouchPolyEvent event = { inMessage.channel, inMessage.data1, inMessage.data2 };
+            invokeVisitor(inVisitor, event);
+            break;
+        }
+        case ControlChange:
+        {
+            const ControlChangeEvent event = { inMessage.channel, inMessage.data1, inMessage.data2 };
+            invokeVisitor(inVisitor, event);
+            break;
+        }
+        case ProgramChange:
+        {
+            const ProgramChangeEvent event = { inMessage.channel, inMessage.data1 };
+            invokeVisitor(inVisitor, event);
+            break;
+        }
+        case AfterTouchChannel:
+        {
+            const AfterTouchChannelEvent event = { inMessage.channel, inMessage.data1 };
+            invokeVisitor(inVisitor, event);
+            break;
+        }
+        case PitchBend:
+        {
+            const PitchBendEvent event = { inMessage.channel, (int)((inMessage.data1 & 0x7f) | ((inMessage.data2 & 0x7f) << 7)) + MIDI_PITCHBEND_MIN };
+            invokeVisitor(inVisitor, event);
+            break;
+        }
+        case SystemExclusive:
+        {
+            const SystemExclusiveEvent event = { inMessage.sysexArray, inMessage.getSysExSize() };
+            invokeVisitor(inVisitor, event);
+            break;
+        }
+        case TimeCodeQuarterFrame:
+        {
+            const TimeCodeQuarterFrameEvent event = { inMessage.data1 };
+            invokeVisitor(inVisitor, event);
+            break;
+        }
+        case SongPosition:
+        {
+            const SongPositionEvent event = { unsigned((inMessage.data1 & 0x7f) | ((inMessage.data2 & 0x7f) << 7)) };
+            invokeVisitor(inVisitor, event);
+            break;
+        }
+        case SongSelect:
+        {
+            const SongSelectEvent event = { inMessage.data1 };
+            invokeVisitor(inVisitor, event);
+            break;
+        }
+        case TuneRequest:   invokeVisitor(inVisitor, TuneRequestEvent());   break;
+        case Clock:         invokeVisitor(inVisitor, ClockEvent());         break;
+        case Start:         invokeVisitor(inVisitor, StartEvent());         break;
+        case Tick:          invokeVisitor(inVisitor, TickEvent());          break;
+        case Continue:      invokeVisitor(inVisitor, ContinueEvent());      break;
+        case Stop:          invokeVisitor(inVisitor, StopEvent());          break;
+        case ActiveSensing: invokeVisitor(inVisitor, ActiveSensingEvent()); break;
+        case SystemReset:   invokeVisitor(inVisitor, SystemResetEvent());   break;
+
+        default:
+            break;
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+// Used to restrict templates to class types (functors, lambdas),
+// without depending on <type_traits> which is not available on AVR.
+template<class T>
+struct IsClass
+{
+    template<class U> static char test(int U::*);
+    template<class U> static long test(...);
+    static const bool value = sizeof(test<T>(0)) == sizeof(char);
+};
+
+template<bool Condition, class T = void>
+struct EnableIf {};
+
+template<class T>
+struct EnableIf<true, T> { typedef T type; };
+
+END_MIDI_NAMESPACE
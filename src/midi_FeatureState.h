@@ -0,0 +1,273 @@
+/*!
+ *  @file       midi_FeatureState.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Optional feature state, elided when disabled
+ *  @author     Francois Best, lathoub
+ *  @date       19/10/26
+ *  @license    MIT - Copyright (c) 2015 Francois Best
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "midi_Defs.h"
+
+BEGIN_MIDI_NAMESPACE
+
+// State of optional features, used as base classes of MidiInterface.
+// The disabled specialisations are empty, so that the empty base
+// optimisation removes them from the interface, and their methods
+// compile to nothing.
+
+/*! \brief Periodic sending of ActiveSensing, see Settings::UseSenderActiveSensing.
+ */
+template<class Platform, bool Enabled>
+class SenderActiveSensingState
+{
+protected:
+    inline SenderActiveSensingState()
+        : mLastMessageSentTime(0)
+        , mSenderActiveSensingPeriodicity(0)
+    {
+    }
+
+    inline void setSenderActiveSensingPeriodicity(unsigned long inPeriodicity)
+    {
+        mSenderActiveSensingPeriodicity = inPeriodicity;
+    }
+
+    inline void resetLastSentTime()
+    {
+        mLastMessageSentTime = Platform::now();
+    }
+
+    inline void updateSentTime()
+    {
+        if (mSenderActiveSensingPeriodicity)
+            mLastMessageSentTime = Platform::now();
+    }
+
+    // True when nothing was sent for longer than the periodicity.
+    inline bool isActiveSensingDue() const
+    {
+        return mSenderActiveSensingPeriodicity > 0 &&
+               (Platform::now() - mLastMessageSentTime) > mSenderActiveSensingPeriodicity;
+    }
+
+private:
+    unsigned long mLastMessageSentTime;
+    unsigned long mSenderActiveSensingPeriodicity;
+};
+
+template<class Platform>
+class SenderActiveSensingState<Platform, false>
+{
+protected:
+    inline void setSenderActiveSensingPeriodicity(unsigned long) {}
+    inline void resetLastSentTime() {}
+    inline void updateSentTime() {}
+    inline bool isActiveSensingDue() const { return false; }
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Timeout of received ActiveSensing, see Settings::UseReceiverActiveSensing.
+ */
+template<class Platform, bool Enabled>
+class ReceiverActiveSensingState
+{
+protected:
+    inline ReceiverActiveSensingState()
+        : mLastMessageReceivedTime(0)
+        , mReceiverActiveSensingActivated(false)
+    {
+    }
+
+    // When an ActiveSensing message is received, the time keeping is activated.
+    inline void activateReceiverActiveSensing()
+    {
+        mReceiverActiveSensingActivated = true;
+    }
+
+    // Keep the time of the last received message, so we can check for the timeout
+    inline void updateLastReceivedTime()
+    {
+        if (mReceiverActiveSensingActivated)
+            mLastMessageReceivedTime = Platform::now();
+    }
+
+    /*! Returns true once when the timeout is reached, and ends time keeping.
+     */
+    inline bool hasReceiverActiveSensingTimedOut()
+    {
+        if (mReceiverActiveSensingActivated &&
+            (mLastMessageReceivedTime + ActiveSensingTimeout < Platform::now()))
+        {
+            mReceiverActiveSensingActivated = false;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    unsigned long mLastMessageReceivedTime;
+    bool mReceiverActiveSensingActivated;
+};
+
+template<class Platform>
+class ReceiverActiveSensingState<Platform, false>
+{
+protected:
+    inline void activateReceiverActiveSensing() {}
+    inline void updateLastReceivedTime() {}
+    inline bool hasReceiverActiveSensingTimedOut() { return false; }
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Time based refresh of the output Running Status,
+ see Settings::RunningStatusRefreshPeriod.
+ */
+template<class Platform, uint16_t Period>
+class RunningStatusRefreshTimer
+{
+protected:
+    inline RunningStatusRefreshTimer()
+        : mLastStatusSentTime(0)
+    {
+    }
+
+    inline bool isStatusRefreshTimeDue() const
+    {
+        return (Platform::now() - mLastStatusSentTime) >= Period;
+    }
+
+    inline void restartStatusRefreshTime()
+    {
+        mLastStatusSentTime = Platform::now();
+    }
+
+private:
+    unsigned long mLastStatusSentTime;
+};
+
+template<class Platform>
+class RunningStatusRefreshTimer<Platform, 0>
+{
+protected:
+    inline bool isStatusRefreshTimeDue() const { return false; }
+    inline void restartStatusRefreshTime() {}
+};
+
+/*! \brief Message count based refresh of the output Running Status,
+ see Settings::RunningStatusRefreshCount.
+ */
+template<unsigned Count>
+class RunningStatusRefreshCounter
+{
+protected:
+    inline RunningStatusRefreshCounter()
+        : mOmittedStatusCount(0)
+    {
+    }
+
+    inline bool isStatusRefreshCountDue() const
+    {
+        return mOmittedStatusCount >= Count;
+    }
+
+    inline void countOmittedStatus()
+    {
+        ++mOmittedStatusCount;
+    }
+
+    inline void resetOmittedStatusCount()
+    {
+        mOmittedStatusCount = 0;
+    }
+
+private:
+    typename SizeType<Count>::type mOmittedStatusCount;
+};
+
+template<>
+class RunningStatusRefreshCounter<0>
+{
+protected:
+    inline bool isStatusRefreshCountDue() const { return false; }
+    inline void countOmittedStatus() {}
+    inline void resetOmittedStatusCount() {}
+};
+
+/*! \brief Running Status of the output, see Settings::UseRunningStatus.
+
+ The status byte is sent again when the refresh period or count is reached,
+ for receivers that joined in the middle of a stream.
+ */
+template<bool Enabled, class Platform = void, uint16_t RefreshPeriod = 0, unsigned RefreshCount = 0>
+class RunningStatusTxState
+    : private RunningStatusRefreshTimer<Platform, RefreshPeriod>
+    , private RunningStatusRefreshCounter<RefreshCount>
+{
+protected:
+    inline RunningStatusTxState()
+        : mRunningStatus_TX(InvalidType)
+    {
+    }
+
+    /*! Returns true if the status byte has to be sent,
+     ie: if it differs from the running status, or needs a refresh.
+     */
+    inline bool updateRunningStatusTx(StatusByte inStatus)
+    {
+        if (mRunningStatus_TX == inStatus &&
+            !this->isStatusRefreshTimeDue() &&
+            !this->isStatusRefreshCountDue())
+        {
+            this->countOmittedStatus();
+            return false;
+        }
+
+        // New message, memorise and send header
+        mRunningStatus_TX = inStatus;
+        this->restartStatusRefreshTime();
+        this->resetOmittedStatusCount();
+        return true;
+    }
+
+    inline void resetRunningStatusTx()
+    {
+        mRunningStatus_TX = InvalidType;
+    }
+
+private:
+    StatusByte mRunningStatus_TX;
+};
+
+template<class Platform, uint16_t RefreshPeriod, unsigned RefreshCount>
+class RunningStatusTxState<false, Platform, RefreshPeriod, RefreshCount>
+{
+protected:
+    // Don't care about running status, always send the status byte.
+    inline bool updateRunningStatusTx(StatusByte) { return true; }
+    inline void resetRunningStatusTx() {}
+};
+
+END_MIDI_NAMESPACE
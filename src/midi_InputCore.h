@@ -0,0 +1,87 @@
+/*!
+ *  @file       midi_InputCore.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Transport-independent input core
+ *  @author     Francois Best, lathoub
+ *  @date       19/10/26
+ *  @license    MIT - Copyright (c) 2015 Francois Best
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "midi_Defs.h"
+#include "midi_Message.h"
+#include "midi_Parser.h"
+#include "midi_EventBlock.h"
+#include "midi_Profiler.h"
+#include "midi_FeatureState.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Input side of MidiInterface: parsing, filtering and dispatch of
+ received messages to the Handler.
+
+ It does not depend on the Transport, so that its code is generated once
+ for all the interfaces sharing the same Settings, Platform and Handler
+ (eg: one on a HardwareSerial and one on a SoftwareSerial), rather than
+ once per transport type. MidiInterface reads the bytes from its transport,
+ and feeds them to the core.
+ */
+template<class Settings, class Platform, class Handler>
+class InputCore
+    : protected ReceiverActiveSensingState<Platform, Settings::UseReceiverActiveSensing>
+    , protected EventBlockQueue<Settings::EventBlockMaxSize>
+    , protected HandlerProfiler<Platform, Settings::UseHandlerProfiler>
+{
+public:
+    typedef Message<Settings::SysExMaxSize, typename Settings::SysExPool> MidiMessage;
+    typedef Parser<Settings::SysExMaxSize, typename Settings::SysExPool> MidiParser;
+
+protected:
+    typedef EventBlockQueue<Settings::EventBlockMaxSize> EventBlockStorage;
+    typedef HandlerProfiler<Platform, Settings::UseHandlerProfiler> Profiler;
+
+protected:
+    inline  InputCore();
+    inline ~InputCore();
+
+protected:
+    typename MidiParser::Status receive(byte inByte);
+    bool dispatch(Channel inChannel);
+    void checkActiveSensingTimeout();
+    void launchCallback();
+    inline void releaseSysEx();
+
+private:
+    inline void handleNullVelocityNoteOnAsNoteOff();
+    inline bool inputFilter(Channel inChannel) const;
+
+protected:
+    MidiParser      mParser;
+    MidiMessage     mMessage;
+    Channel         mInputChannel;
+    int8_t          mLastError;
+    Handler         mHandler;
+};
+
+END_MIDI_NAMESPACE
+
+#include "midi_InputCore.hpp"
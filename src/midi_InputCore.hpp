@@ -0,0 +1,241 @@
+/*!
+ *  @file       midi_InputCore.hpp
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Transport-independent input core - Implementation
+ *  @author     Francois Best, lathoub
+ *  @date       19/10/26
+ *  @license    MIT - Copyright (c) 2015 Francois Best
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+BEGIN_MIDI_NAMESPACE
+
+template<class Settings, class Platform, class Handler>
+inline InputCore<Settings, Platform, Handler>::InputCore()
+    : mInputChannel(0)
+    , mLastError(0)
+{
+}
+
+template<class Settings, class Platform, class Handler>
+inline InputCore<Settings, Platform, Handler>::~InputCore()
+{
+    mMessage.releaseSysEx();
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Feed a received byte to the parser.
+
+ Chunks of SysEx messages too large for the array are dispatched directly
+ (SysEx ignores the input channel), and parsing errors are reported to the
+ Handler.
+ \return Complete when a message is ready to be dispatched.
+ */
+template<class Settings, class Platform, class Handler>
+typename InputCore<Settings, Platform, Handler>::MidiParser::Status
+InputCore<Settings, Platform, Handler>::receive(byte inByte)
+{
+    const typename MidiParser::Status status = mParser.parse(inByte, mMessage);
+
+    switch (status)
+    {
+        case MidiParser::SysExChunk:
+            // No need to check against the inputChannel,
+            // SysEx ignores input channel
+            launchCallback();
+            mParser.continueSysEx(mMessage);
+            break;
+
+        case MidiParser::Error:
+            mLastError |= 1UL << ErrorParse; // set the ErrorParse bit
+            mHandler.onError(mLastError); // LCOV_EXCL_LINE
+            break;
+
+        default:
+            break;
+    }
+    return status;
+}
+
+/*! \brief Give the SysEx block of the last message back to the pool (see
+ Settings::SysExPool), unless a SysEx is still being received.
+ Called before reading, once the last message has been dispatched, so that
+ an input going quiet after a SysEx does not keep its block.
+ */
+template<class Settings, class Platform, class Handler>
+inline void InputCore<Settings, Platform, Handler>::releaseSysEx()
+{
+    if (!mParser.isReceivingSysEx())
+        mMessage.releaseSysEx();
+}
+
+/*! \brief Dispatch the message that has just been parsed.
+ \return True if the message matches the input channel.
+ */
+template<class Settings, class Platform, class Handler>
+bool InputCore<Settings, Platform, Handler>::dispatch(Channel inChannel)
+{
+    #ifndef RegionActiveSending
+
+    if (Settings::UseReceiverActiveSensing && mMessage.type == ActiveSensing)
+    {
+        // When an ActiveSensing message is received, the time keeping is activated.
+        // When a timeout occurs, an error message is send and time keeping ends.
+        this->activateReceiverActiveSensing();
+
+        // is ErrorActiveSensingTimeout bit in mLastError on
+        if (mLastError & (1 << (ErrorActiveSensingTimeout - 1)))
+        {
+            mLastError &= ~(1UL << ErrorActiveSensingTimeout); // clear the ErrorActiveSensingTimeout bit
+            mHandler.onError(mLastError);
+        }
+    }
+
+    this->updateLastReceivedTime();
+
+    #endif
+
+    handleNullVelocityNoteOnAsNoteOff();
+
+    const bool channelMatch = inputFilter(inChannel);
+    if (channelMatch)
+    {
+        launchCallback();
+
+        if (Settings::EventBlockMaxSize > 0 && mMessage.type != SystemExclusive)
+        {
+            EventBlockStorage::push(Platform::now(),
+                                    mMessage.type,
+                                    mMessage.channel,
+                                    mMessage.data1,
+                                    mMessage.data2);
+        }
+    }
+    return channelMatch;
+}
+
+/*! \brief Report a timeout of the received ActiveSensing to the Handler.
+ */
+template<class Settings, class Platform, class Handler>
+void InputCore<Settings, Platform, Handler>::checkActiveSensingTimeout()
+{
+    if (this->hasReceiverActiveSensingTimedOut())
+    {
+        mLastError |= 1UL << ErrorActiveSensingTimeout; // set the ErrorActiveSensingTimeout bit
+        mHandler.onError(mLastError);
+    }
+}
+
+// Launch callback function based on received type.
+template<class Settings, class Platform, class Handler>
+void InputCore<Settings, Platform, Handler>::launchCallback()
+{
+    const unsigned long startTime = Profiler::start();
+
+    mHandler.onMessage(mMessage);
+
+    // The order is mixed to allow frequent messages to trigger their callback faster.
+    switch (mMessage.type)
+    {
+            // Notes
+        case NoteOff:               mHandler.onNoteOff(mMessage.channel, mMessage.data1, mMessage.data2);   break;
+        case NoteOn:                mHandler.onNoteOn(mMessage.channel, mMessage.data1, mMessage.data2);    break;
+
+            // Real-time messages
+        case Clock:                 mHandler.onClock();           break;
+        case Start:                 mHandler.onStart();           break;
+        case Tick:                  mHandler.onTick();            break;
+        case Continue:              mHandler.onContinue();        break;
+        case Stop:                  mHandler.onStop();            break;
+        case ActiveSensing:         mHandler.onActiveSensing();   break;
+
+            // Continuous controllers
+        case ControlChange:         mHandler.onControlChange(mMessage.channel, mMessage.data1, mMessage.data2);    break;
+        case PitchBend:             mHandler.onPitchBend(mMessage.channel, (int)((mMessage.data1 & 0x7f) | ((mMessage.data2 & 0x7f) << 7)) + MIDI_PITCHBEND_MIN); break;
+        case AfterTouchPoly:        mHandler.onAfterTouchPoly(mMessage.channel, mMessage.data1, mMessage.data2);    break;
+        case AfterTouchChannel:     mHandler.onAfterTouchChannel(mMessage.channel, mMessage.data1);    break;
+
+        case ProgramChange:         mHandler.onProgramChange(mMessage.channel, mMessage.data1);    break;
+        case SystemExclusive:       mHandler.onSystemExclusive(mMessage.sysexArray, mMessage.getSysExSize());    break;
+
+            // Occasional messages
+        case TimeCodeQuarterFrame:  mHandler.onTimeCodeQuarterFrame(mMessage.data1);    break;
+        case SongPosition:          mHandler.onSongPosition(unsigned((mMessage.data1 & 0x7f) | ((mMessage.data2 & 0x7f) << 7)));    break;
+        case SongSelect:            mHandler.onSongSelect(mMessage.data1);    break;
+        case TuneRequest:           mHandler.onTuneRequest();    break;
+
+        case SystemReset:           mHandler.onSystemReset();    break;
+
+        // LCOV_EXCL_START - Unreacheable code, but prevents unhandled case warning.
+        case InvalidType:
+        default:
+            break;
+        // LCOV_EXCL_STOP
+    }
+
+    Profiler::stop(mMessage.type, startTime);
+}
+
+// -----------------------------------------------------------------------------
+
+// See midi_Settings.h for documentation
+template<class Settings, class Platform, class Handler>
+inline void InputCore<Settings, Platform, Handler>::handleNullVelocityNoteOnAsNoteOff()
+{
+    if (Settings::HandleNullVelocityNoteOnAsNoteOff &&
+        mMessage.type == NoteOn && mMessage.data2 == 0)
+    {
+        mMessage.type = NoteOff;
+    }
+}
+
+// Check if the received message is on the listened channel
+template<class Settings, class Platform, class Handler>
+inline bool InputCore<Settings, Platform, Handler>::inputFilter(Channel inChannel) const
+{
+    // This method handles recognition of channel
+    // (to know if the message is destinated to the Arduino)
+
+    // First, check if the received message is Channel
+    if (mMessage.type >= NoteOff && mMessage.type <= PitchBend)
+    {
+        // Then we need to know if we listen to it
+        if ((mMessage.channel == inChannel) ||
+            (inChannel == MIDI_CHANNEL_OMNI))
+        {
+            return true;
+        }
+        else
+        {
+            // We don't listen to this channel
+            return false;
+        }
+    }
+    else
+    {
+        // System messages are always received
+        return true;
+    }
+}
+
+END_MIDI_NAMESPACE
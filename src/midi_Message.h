@@ -35,12 +35,110 @@
 
 BEGIN_MIDI_NAMESPACE
 
+/*! Storage of the SysEx data of a Message.
+ \n By default, each message holds its own array. When a SysExPool is given,
+ the message only holds a pointer to a block borrowed from the pool, see
+ Settings::SysExPool.
+ \warning With a SysExPool, copies of a message share the block of the
+ interface that received it, without owning it: their SysEx data is only
+ valid until the next call to read(), which gives the block back to the pool.
+ Copy the bytes out of sysexArray to keep them longer.
+ */
+template<unsigned SysExMaxSize, class SysExPool>
+struct SysExStorage
+{
+    static_assert(SysExPool::sBlockSize >= SysExMaxSize, "SysExPool blocks must hold SysExMaxSize bytes");
+
+    inline SysExStorage()
+        : sysexArray(nullptr)
+    {
+    }
+
+    // Copies refer to the same block, and do not own it.
+    inline SysExStorage(const SysExStorage& inOther)
+        : sysexArray(inOther.sysexArray)
+    {
+    }
+
+    inline SysExStorage& operator=(const SysExStorage& inOther)
+    {
+        sysexArray = inOther.sysexArray;
+        return *this;
+    }
+
+    inline void copySysEx(const SysExStorage&, unsigned)
+    {
+    }
+
+    /*! Borrow a block from the pool, if not already done.
+     \return False if the pool is exhausted.
+     */
+    inline bool acquireSysEx()
+    {
+        if (sysexArray == nullptr)
+            sysexArray = SysExPool::acquire();
+        return sysexArray != nullptr;
+    }
+
+    /*! Give the block back to the pool.
+     */
+    inline void releaseSysEx()
+    {
+        if (sysexArray != nullptr)
+        {
+            SysExPool::release(sysexArray);
+            sysexArray = nullptr;
+        }
+    }
+
+    /*! System Exclusive data, in a block of the pool (nullptr if none).
+     */
+    DataByte* sysexArray;
+};
+
+template<unsigned SysExMaxSize>
+struct SysExStorage<SysExMaxSize, void>
+{
+    // The array is left uninitialised, it is only read for SysEx messages.
+    inline SysExStorage()
+    {
+    }
+
+    // Data is only copied for SysEx messages, see copySysEx.
+    inline SysExStorage(const SysExStorage&)
+    {
+    }
+
+    inline SysExStorage& operator=(const SysExStorage&)
+    {
+        return *this;
+    }
+
+    inline void copySysEx(const SysExStorage& inOther, unsigned inSize)
+    {
+        memcpy(sysexArray, inOther.sysexArray, inSize * sizeof(DataByte));
+    }
+
+    inline bool acquireSysEx() { return true; }
+    inline void releaseSysEx() {}
+
+    /*! System Exclusive dedicated byte array.
+     \n Array length is stocked on 16 bits,
+     in data1 (LSB) and data2 (MSB)
+     */
+    DataByte sysexArray[SysExMaxSize];
+};
+
+// -----------------------------------------------------------------------------
+
 /*! The Message structure contains decoded data of a MIDI message
     read from the serial port with read()
  */
-template<unsigned SysExMaxSize>
-struct Message
+template<unsigned SysExMaxSize, class SysExPool = void>
+struct Message : public SysExStorage<SysExMaxSize, SysExPool>
 {
+    typedef SysExStorage<SysExMaxSize, SysExPool> Storage;
+
     /*! Default constructor
      \n Initializes the attributes with their default values.
     */
@@ -50,12 +148,17 @@ struct Message
         , data1(0)
         , data2(0)
         , valid(false)
+        , length(0)
     {
-        memset(sysexArray, 0, sSysExMaxSize * sizeof(DataByte));
     }
 
+    /*! Copy constructor
+     \n Only the getSysExSize() bytes of a SysEx message are copied.
+     With a SysExPool, only the pointer to the block is (see SysExStorage).
+    */
     inline Message(const Message& inOther)
-        : channel(inOther.channel)
+        : Storage(inOther)
+        , channel(inOther.channel)
         , type(inOther.type)
         , data1(inOther.data1)
         , data2(inOther.data2)
@@ -64,10 +167,30 @@ struct Message
     {
         if (type == midi::SystemExclusive)
         {
-            memcpy(sysexArray, inOther.sysexArray, sSysExMaxSize * sizeof(DataByte));
+            this->copySysEx(inOther, inOther.getSysExSize());
         }
     }
 
+    inline Message& operator=(const Message& inOther)
+    {
+        if (this != &inOther)
+        {
+            Storage::operator=(inOther);
+            channel = inOther.channel;
+            type    = inOther.type;
+            data1   = inOther.data1;
+            data2   = inOther.data2;
+            valid   = inOther.valid;
+            length  = inOther.length;
+
+            if (type == midi::SystemExclusive)
+            {
+                this->copySysEx(inOther, inOther.getSysExSize());
+            }
+        }
+        return *this;
+    }
+
     /*! The maximum size for the System Exclusive array.
     */
     static const unsigned sSysExMaxSize = SysExMaxSize;
@@ -93,12 +216,6 @@ struct Message
      */
     DataByte data2;
 
-    /*! System Exclusive dedicated byte array.
-     \n Array length is stocked on 16 bits,
-     in data1 (LSB) and data2 (MSB)
-     */
-    DataByte sysexArray[sSysExMaxSize];
-
     /*! This boolean indicates if the message is valid or not.
      There is no channel consideration here,
      validity means the message respects the MIDI norm.
@@ -107,7 +224,7 @@ struct Message
 
     /*! Total Length of the message.
      */
-    unsigned length;
+    typename SizeType<SysExMaxSize>::type length;
 
     inline unsigned getSysExSize() const
     {
@@ -128,4 +245,55 @@ struct Message
     }
 };
 
+// -----------------------------------------------------------------------------
+
+/*! A lightweight, non-owning view of a Message, to pass messages around
+    (eg: in queues or callbacks) without copying their SysEx array.
+    \n The SysEx data is not copied: the view is only valid as long as the
+    message it was made from.
+ */
+struct MessageView
+{
+    inline MessageView()
+        : type(MIDI_NAMESPACE::InvalidType)
+        , channel(0)
+        , data1(0)
+        , data2(0)
+        , sysexArray(nullptr)
+        , sysexSize(0)
+    {
+    }
+
+    template<unsigned SysExMaxSize, class SysExPool>
+    inline MessageView(const Message<SysExMaxSize, SysExPool>& inMessage)
+        : type(inMessage.type)
+        , channel(inMessage.channel)
+        , data1(inMessage.data1)
+        , data2(inMessage.data2)
+        , sysexArray(inMessage.type == MIDI_NAMESPACE::SystemExclusive ? inMessage.sysexArray : nullptr)
+        , sysexSize(inMessage.type == MIDI_NAMESPACE::SystemExclusive ? inMessage.getSysExSize() : 0)
+    {
+    }
+
+    MidiType type;                  ///< The type of the message.
+    Channel channel;                ///< Channel, 1 to 16 for channel messages.
+    DataByte data1;                 ///< The first data byte.
+    DataByte data2;                 ///< The second data byte.
+    const DataByte* sysexArray;     ///< SysEx data, including the boundaries (nullptr if not SysEx).
+    unsigned sysexSize;             ///< Number of bytes in sysexArray.
+
+    inline bool isSystemRealTime () const
+    {
+          return (type & 0xf8) == 0xf8;
+    }
+    inline bool isSystemCommon () const
+    {
+          return (type & 0xf8) == 0xf0;
+    }
+    inline bool isChannelMessage () const
+    {
+          return (type & 0xf0) != 0xf0;
+    }
+};
+
 END_MIDI_NAMESPACE
@@ -0,0 +1,198 @@
+/*!
+ *  @file       midi_OutputCache.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Output cache and channel state
+ *  @author     Francois Best, lathoub
+ *  @date       19/10/26
+ *  @license    MIT - Copyright (c) 2015 Francois Best
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "midi_Defs.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Values of the controllers, program, channel pressure and pitch bend
+ of a channel, eg: a scene snapshot for MidiInterface::syncTo.
+
+ Values set to sUnset are unknown, or left as they are when synchronising.
+ Pitch bend is the 14 bits value sent (0 to 16383, 8192 is the center).
+ Control Changes that trigger an action (Data Increment / Decrement,
+ parameter number selection and Channel Mode messages) are not part of
+ the state.
+ */
+struct ChannelState
+{
+    // Values are 7 bits, the MSB marks unset values.
+    static const byte sUnset = 0xff;
+    static const uint16_t sUnsetPitchBend = 0xffff;
+    // Channel Mode messages (120 to 127) are not held.
+    static const unsigned sNumControls = AllSoundOff;
+
+    inline ChannelState()
+    {
+        clear();
+    }
+
+    inline void clear()
+    {
+        clearControls();
+        program = sUnset;
+    }
+
+    inline void clearControls()
+    {
+        for (unsigned i = 0; i < sNumControls; ++i)
+            controls[i] = sUnset;
+        pressure  = sUnset;
+        pitchBend = sUnsetPitchBend;
+    }
+
+    static inline bool isHeld(DataByte inControlNumber)
+    {
+        return inControlNumber < sNumControls &&
+              (inControlNumber < DataIncrement || inControlNumber > RPNMSB);
+    }
+
+    byte controls[sNumControls];
+    byte program;
+    byte pressure;
+    uint16_t pitchBend;
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Last values sent on each channel, see Settings::UseOutputCache.
+
+ Keeps the Control Change values, program, channel pressure and pitch bend
+ sent on each channel, so that messages that would not change anything on
+ the receiver can be skipped.
+ Control Changes that are not part of a ChannelState are never skipped.
+ Selecting a new parameter number forgets the Data Entry values, sending a
+ Bank Select forgets the program (so that the next Program Change loads the
+ new bank), and Reset All Controllers forgets the values of the channel but
+ its program.
+ */
+template<bool Enabled>
+class OutputCache
+{
+public:
+    /*! \brief True when the message would not change the receiver's state.
+     */
+    inline bool isRedundant(MidiType inType,
+                            DataByte inData1,
+                            DataByte inData2,
+                            Channel inChannel) const
+    {
+        const ChannelState& state = mChannels[inChannel - 1];
+        switch (inType)
+        {
+            case ControlChange:
+                return ChannelState::isHeld(inData1) && state.controls[inData1] == inData2;
+            case ProgramChange:
+                return state.program == inData1;
+            case AfterTouchChannel:
+                return state.pressure == inData1;
+            case PitchBend:
+                return state.pitchBend == pitchBend(inData1, inData2);
+            default:
+                return false;
+        }
+    }
+
+    /*! \brief Remember a message that was sent.
+     */
+    inline void update(MidiType inType,
+                       DataByte inData1,
+                       DataByte inData2,
+                       Channel inChannel)
+    {
+        ChannelState& state = mChannels[inChannel - 1];
+        switch (inType)
+        {
+            case ControlChange:
+                if (ChannelState::isHeld(inData1))
+                {
+                    state.controls[inData1] = inData2;
+
+                    // The new bank is only loaded by the next Program Change
+                    if (inData1 == BankSelect || inData1 == BankSelectLSB)
+                        state.program = ChannelState::sUnset;
+                }
+                else if (inData1 >= NRPNLSB && inData1 <= RPNMSB)
+                {
+                    // Data Entry now applies to another parameter
+                    state.controls[DataEntryMSB] = ChannelState::sUnset;
+                    state.controls[DataEntryLSB] = ChannelState::sUnset;
+                }
+                else if (inData1 == ResetAllControllers)
+                {
+                    state.clearControls();
+                }
+                break;
+            case ProgramChange:
+                state.program = inData1;
+                break;
+            case AfterTouchChannel:
+                state.pressure = inData1;
+                break;
+            case PitchBend:
+                state.pitchBend = pitchBend(inData1, inData2);
+                break;
+            default:
+                break;
+        }
+    }
+
+    /*! \brief Forget the values of a channel (1 to 16), or of all channels
+     with MIDI_CHANNEL_OMNI.
+     */
+    inline void clear(Channel inChannel)
+    {
+        for (unsigned channel = 0; channel < 16; ++channel)
+        {
+            if (inChannel == MIDI_CHANNEL_OMNI || inChannel == channel + 1)
+                mChannels[channel].clear();
+        }
+    }
+
+private:
+    static inline uint16_t pitchBend(DataByte inLsb, DataByte inMsb)
+    {
+        return uint16_t(inLsb | (inMsb << 7));
+    }
+
+private:
+    ChannelState mChannels[16];
+};
+
+template<>
+class OutputCache<false>
+{
+public:
+    inline bool isRedundant(MidiType, DataByte, DataByte, Channel) const { return false; }
+    inline void update(MidiType, DataByte, DataByte, Channel) {}
+    inline void clear(Channel) {}
+};
+
+END_MIDI_NAMESPACE
@@ -0,0 +1,168 @@
+/*!
+ *  @file       midi_PacedSysEx.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Paced SysEx sender
+ *  @author     Francois Best, lathoub
+ *  @date       19/10/26
+ *  @license    MIT - Copyright (c) 2015 Francois Best
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "midi_Defs.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Progress of a SysEx sent in chunks, see Settings::UsePacedSysEx.
+
+ The SysEx is seen as a stream of bytes, including the boundaries even if
+ the array does not contain them. Each chunk is due once the gap has elapsed
+ since the previous one was sent.
+ */
+template<class Platform, bool Enabled>
+class PacedSysExState
+{
+protected:
+    inline PacedSysExState()
+        : mData(nullptr)
+        , mLength(0)
+        , mPosition(0)
+        , mChunkSize(0)
+        , mChunkGap(0)
+        , mLastChunkTime(0)
+        , mBoundaries(false)
+        , mWriting(false)
+        , mRejected(false)
+    {
+    }
+
+    inline void startPacedSysEx(const byte* inData,
+                                unsigned inLength,
+                                unsigned inChunkSize,
+                                unsigned long inChunkGap,
+                                bool inContainsBoundaries)
+    {
+        mData       = inData;
+        mLength     = inContainsBoundaries ? inLength : inLength + 2;
+        mPosition   = 0;
+        mChunkSize  = inChunkSize > 0 ? inChunkSize : 1;
+        mChunkGap   = inChunkGap;
+        mBoundaries = inContainsBoundaries;
+        mWriting    = false;
+    }
+
+    inline bool isPacedSysExActive() const
+    {
+        return mPosition < mLength;
+    }
+
+    // True while MidiInterface writes a chunk.
+    inline bool isPacedSysExWriting() const
+    {
+        return mWriting;
+    }
+
+    /*! Other messages but real-time ones would end the frame: they are
+     rejected while it is sent, and the last rejection is remembered for
+     MidiInterface::isSendAccepted.
+     \return True if a message of this type must be rejected now.
+     */
+    inline bool rejectDuringPacedSysEx(MidiType inType)
+    {
+        if (mWriting)
+            return false;
+
+        mRejected = inType < Clock && isPacedSysExActive();
+        return mRejected;
+    }
+
+    inline bool isRejectedDuringPacedSysEx() const
+    {
+        return mRejected;
+    }
+
+    /*! Returns the length of the chunk to write now, or 0 if none is due.
+     */
+    inline unsigned beginPacedSysExChunk()
+    {
+        if (!isPacedSysExActive())
+            return 0;
+
+        if (mPosition > 0 && (Platform::now() - mLastChunkTime) < mChunkGap)
+            return 0;
+
+        mWriting = true;
+        const unsigned remaining = mLength - mPosition;
+        return remaining < mChunkSize ? remaining : mChunkSize;
+    }
+
+    inline byte getPacedSysExByte(unsigned inOffset) const
+    {
+        const unsigned position = mPosition + inOffset;
+        if (mBoundaries)
+            return mData[position];
+        if (position == 0)
+            return SystemExclusiveStart;
+        if (position == mLength - 1)
+            return SystemExclusiveEnd;
+        return mData[position - 1];
+    }
+
+    /*! The chunk is written again on the next call if it was not sent.
+     */
+    inline void endPacedSysExChunk(bool inSent, unsigned inLength)
+    {
+        mWriting = false;
+        if (inSent)
+        {
+            mPosition += inLength;
+            mLastChunkTime = Platform::now();
+        }
+    }
+
+private:
+    const byte* mData;
+    unsigned mLength;
+    unsigned mPosition;
+    unsigned mChunkSize;
+    unsigned long mChunkGap;
+    unsigned long mLastChunkTime;
+    bool mBoundaries;
+    bool mWriting;
+    bool mRejected;
+};
+
+template<class Platform>
+class PacedSysExState<Platform, false>
+{
+protected:
+    inline void startPacedSysEx(const byte*, unsigned, unsigned, unsigned long, bool) {}
+    inline bool isPacedSysExActive() const { return false; }
+    inline bool isPacedSysExWriting() const { return false; }
+    inline bool rejectDuringPacedSysEx(MidiType) { return false; }
+    inline bool isRejectedDuringPacedSysEx() const { return false; }
+    inline unsigned beginPacedSysExChunk() { return 0; }
+    inline byte getPacedSysExByte(unsigned) const { return 0; }
+    inline void endPacedSysExChunk(bool, unsigned) {}
+};
+
+END_MIDI_NAMESPACE
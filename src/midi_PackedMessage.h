@@ -0,0 +1,140 @@
+/*!
+ *  @file       midi_PackedMessage.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - 32-bit packed message representation
+ *  @author     Francois Best, lathoub
+ *  @date       19/10/26
+ *  @license    MIT - Copyright (c) 2015 Francois Best
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "midi_Defs.h"
+#include "midi_Message.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief A channel, System Common or Real Time message packed in 32 bits,
+ for queues, logs and routing.
+
+ Layout of the word, from the least significant byte:
+ status byte, data1, data2, and a user byte (eg: a port number or flags).
+ SysEx messages cannot be packed, they give an invalid PackedMessage.
+ */
+struct PackedMessage
+{
+    uint32_t word;
+
+    constexpr PackedMessage()
+        : word(0)
+    {
+    }
+
+    constexpr explicit PackedMessage(uint32_t inWord)
+        : word(inWord)
+    {
+    }
+
+    constexpr PackedMessage(MidiType inType,
+                            Channel inChannel,
+                            DataByte inData1,
+                            DataByte inData2,
+                            byte inPort = 0)
+        : word(inType == SystemExclusive || inType == InvalidType
+               ? 0
+               : uint32_t(getStatus(inType, inChannel))
+                 | uint32_t(inData1 & 0x7f) << 8
+                 | uint32_t(inData2 & 0x7f) << 16
+                 | uint32_t(inPort) << 24)
+    {
+    }
+
+    constexpr StatusByte status() const { return StatusByte(word & 0xff); }
+    constexpr DataByte data1() const    { return DataByte((word >> 8) & 0xff); }
+    constexpr DataByte data2() const    { return DataByte((word >> 16) & 0xff); }
+    constexpr byte port() const         { return byte(word >> 24); }
+
+    constexpr bool valid() const
+    {
+        return status() >= 0x80;
+    }
+
+    constexpr MidiType type() const
+    {
+        return status() < 0xf0 ? MidiType(status() & 0xf0) : MidiType(status());
+    }
+
+    /*! Channel of the message, 1 to 16, or 0 for system messages.
+     */
+    constexpr Channel channel() const
+    {
+        return status() < 0xf0 ? Channel((status() & 0x0f) + 1) : Channel(0);
+    }
+
+    /*! Number of bytes of the message on the wire.
+     */
+    constexpr unsigned length() const
+    {
+        return (type() == ProgramChange || type() == AfterTouchChannel ||
+                type() == TimeCodeQuarterFrame || type() == SongSelect) ? 2
+             : (type() == TuneRequest || type() >= Clock) ? 1
+             : 3;
+    }
+
+    constexpr bool operator==(const PackedMessage& inOther) const { return word == inOther.word; }
+    constexpr bool operator!=(const PackedMessage& inOther) const { return word != inOther.word; }
+
+private:
+    static constexpr StatusByte getStatus(MidiType inType, Channel inChannel)
+    {
+        return inType < SystemExclusive ? StatusByte(inType | ((inChannel - 1) & 0x0f))
+                                        : StatusByte(inType);
+    }
+};
+
+/*! \brief Pack a received message.
+ \param inPort User byte stored along with the message (eg: the input port).
+ */
+template<unsigned SysExMaxSize, class SysExPool>
+constexpr PackedMessage pack(const Message<SysExMaxSize, SysExPool>& inMessage, byte inPort = 0)
+{
+    return PackedMessage(inMessage.type,
+                         inMessage.channel,
+                         inMessage.data1,
+                         inMessage.data2,
+                         inPort);
+}
+
+/*! \brief Unpack a message.
+ The SysEx array of the message is not touched.
+ */
+template<unsigned SysExMaxSize, class SysExPool>
+inline void unpack(PackedMessage inPacked, Message<SysExMaxSize, SysExPool>& outMessage)
+{
+    outMessage.type    = inPacked.type();
+    outMessage.channel = inPacked.channel();
+    outMessage.data1   = inPacked.data1();
+    outMessage.data2   = inPacked.data2();
+    outMessage.length  = typename SizeType<SysExMaxSize>::type(inPacked.length());
+    outMessage.valid   = inPacked.valid();
+}
+
+END_MIDI_NAMESPACE
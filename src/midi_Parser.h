@@ -0,0 +1,213 @@
+/*!
+ *  @file       midi_Parser.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Transport-independent MIDI parser
+ *  @author     Francois Best, lathoub
+ *  @date       19/10/26
+ *  @license    MIT - Copyright (c) 2015 Francois Best
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "midi_Defs.h"
+#include "midi_Message.h"
+#include "midi_Settings.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief MIDI input state machine, fed one byte at a time.
+
+ The parser only holds the state of the pending message, the decoded
+ message is written to a Message owned by the caller. With a SysExPool, a
+ block is borrowed for the message when a SysEx starts, and given back when
+ the next message starts (MidiInterface gives it back on the next read, see
+ InputCore::releaseSysEx). It is used by
+ MidiInterface to parse the bytes read from the transport, and by
+ messages() to decode a buffer.
+ */
+template<unsigned SysExMaxSize, class SysExPool = void>
+class Parser
+{
+public:
+    typedef Message<SysExMaxSize, SysExPool> MidiMessage;
+
+    enum Status
+    {
+        Pending = 0,    ///< More bytes are needed to complete a message.
+        Complete,       ///< A message has been stored.
+        SysExChunk,     ///< A chunk of a SysEx too large for the array has been stored (see continueSysEx).
+        Error,          ///< Unexpected byte, the input state has been reset.
+    };
+
+public:
+    inline Parser();
+
+public:
+    Status parse(byte inByte, MidiMessage& ioMessage);
+    inline void continueSysEx(MidiMessage& ioMessage);
+    inline void reset();
+    inline bool isReceivingSysEx() const;
+
+public:
+    static inline MidiType getTypeFromStatusByte(byte inStatus);
+    static inline Channel getChannelFromStatusByte(byte inStatus);
+    static inline bool isChannelMessage(MidiType inType);
+
+private:
+    typedef typename SizeType<SysExMaxSize>::type Index;
+
+    // Read for every byte, kept together.
+    Index       mPendingMessageIndex;
+    Index       mPendingMessageExpectedLength;
+    StatusByte  mRunningStatus;
+    byte        mPendingMessage[3];
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Forward iterator over the messages decoded from a buffer.
+ The parser state and the current message live in the iterator.
+ */
+template<unsigned SysExMaxSize>
+class MessageIterator
+{
+public:
+    typedef Parser<SysExMaxSize> MidiParser;
+    typedef typename MidiParser::MidiMessage MidiMessage;
+
+public:
+    inline MessageIterator()
+        : mPosition(nullptr)
+        , mEnd(nullptr)
+        , mChunk(false)
+        , mAtEnd(true)
+    {
+    }
+
+    inline MessageIterator(const byte* inBegin, const byte* inEnd)
+        : mPosition(inBegin)
+        , mEnd(inEnd)
+        , mChunk(false)
+        , mAtEnd(false)
+    {
+        advance();
+    }
+
+public:
+    inline const MidiMessage& operator*() const  { return mMessage; }
+    inline const MidiMessage* operator->() const { return &mMessage; }
+
+    inline MessageIterator& operator++()
+    {
+        advance();
+        return *this;
+    }
+
+    inline bool operator==(const MessageIterator& inOther) const
+    {
+        if (mAtEnd || inOther.mAtEnd)
+            return mAtEnd == inOther.mAtEnd;
+        return mPosition == inOther.mPosition;
+    }
+
+    inline bool operator!=(const MessageIterator& inOther) const
+    {
+        return !(*this == inOther);
+    }
+
+private:
+    inline void advance()
+    {
+        if (mChunk)
+        {
+            mParser.continueSysEx(mMessage);
+            mChunk = false;
+        }
+
+        while (mPosition != mEnd)
+        {
+            const typename MidiParser::Status status = mParser.parse(*mPosition++, mMessage);
+            if (status == MidiParser::Complete)
+                return;
+            if (status == MidiParser::SysExChunk)
+            {
+                mChunk = true;
+                return;
+            }
+        }
+        mAtEnd = true;
+    }
+
+private:
+    const byte* mPosition;
+    const byte* mEnd;
+    MidiParser mParser;
+    MidiMessage mMessage;
+    bool mChunk;
+    bool mAtEnd;
+};
+
+/*! \brief Range of the messages decoded from a buffer, see messages().
+ */
+template<unsigned SysExMaxSize>
+class MessageRange
+{
+public:
+    typedef MessageIterator<SysExMaxSize> iterator;
+    typedef MessageIterator<SysExMaxSize> const_iterator;
+
+public:
+    inline MessageRange(const byte* inData, unsigned inLength)
+        : mBegin(inData)
+        , mEnd(inData + inLength)
+    {
+    }
+
+    inline iterator begin() const { return iterator(mBegin, mEnd); }
+    inline iterator end() const   { return iterator(); }
+
+private:
+    const byte* mBegin;
+    const byte* mEnd;
+};
+
+/*! \brief Decode the messages contained in a buffer.
+
+ \code{.cpp}
+ for (const auto& message : midi::messages(buffer, length))
+ {
+     // ...
+ }
+ \endcode
+ Messages are yielded by reference and remain valid until the iterator is
+ incremented. Invalid bytes are skipped, and SysEx messages larger than
+ SysExMaxSize are split into chunks like MidiInterface does. The buffer is
+ not copied and must outlive the range.
+ */
+template<unsigned SysExMaxSize = DefaultSettings::SysExMaxSize>
+inline MessageRange<SysExMaxSize> messages(const byte* inData, unsigned inLength)
+{
+    return MessageRange<SysExMaxSize>(inData, inLength);
+}
+
+END_MIDI_NAMESPACE
+
+#include "midi_Parser.hpp"
@@ -0,0 +1,392 @@
+/*!
+ *  @file       midi_Parser.hpp
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Transport-independent MIDI parser - Implementation
+ *  @author     Francois Best, lathoub
+ *  @date       19/10/26
+ *  @license    MIT - Copyright (c) 2015 Francois Best
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+BEGIN_MIDI_NAMESPACE
+
+template<unsigned SysExMaxSize, class SysExPool>
+inline Parser<SysExMaxSize, SysExPool>::Parser()
+    : mPendingMessageIndex(0)
+    , mPendingMessageExpectedLength(0)
+    , mRunningStatus(InvalidType)
+{
+}
+
+/*! \brief Parse one byte of input.
+
+ Parsing algorithm:
+ If there is no pending message to be recomposed, start a new one.
+  - Find type and channel (if pertinent)
+  - Wait for other bytes, until the message is assembled.
+ Else, add the byte to the pending message, and check validity.
+ When the message is done, store it.
+ */
+template<unsigned SysExMaxSize, class SysExPool>
+typename Parser<SysExMaxSize, SysExPool>::Status Parser<SysExMaxSize, SysExPool>::parse(byte inByte,
+                                                                             MidiMessage& ioMessage)
+{
+    // Ignore Undefined
+    if (inByte == Undefined_FD)
+        return Pending;
+
+    if (mPendingMessageIndex == 0)
+    {
+        // Start a new pending message
+        mPendingMessage[0] = inByte;
+
+        // Check for running status first
+        if (isChannelMessage(getTypeFromStatusByte(mRunningStatus)))
+        {
+            // Only these types allow Running Status
+
+            // If the status byte is not received, prepend it
+            // to the pending message
+            if (inByte < 0x80)
+            {
+                mPendingMessage[0]   = mRunningStatus;
+                mPendingMessage[1]   = inByte;
+                mPendingMessageIndex = 1;
+            }
+            // Else: well, we received another status byte,
+            // so the running status does not apply here.
+            // It will be updated upon completion of this message.
+        }
+
+        const MidiType pendingType = getTypeFromStatusByte(mPendingMessage[0]);
+
+        // The previous SysEx is overwritten, give its block back.
+        if (pendingType != SystemExclusiveStart && pendingType != SystemExclusiveEnd)
+            ioMessage.releaseSysEx();
+
+        switch (pendingType)
+        {
+            // 1 byte messages
+            case Start:
+            case Continue:
+            case Stop:
+            case Clock:
+            case Tick:
+            case ActiveSensing:
+            case SystemReset:
+            case TuneRequest:
+                // Handle the message type directly here.
+                ioMessage.type    = pendingType;
+                ioMessage.channel = 0;
+                ioMessage.data1   = 0;
+                ioMessage.data2   = 0;
+                ioMessage.valid   = true;
+
+                // Do not reset all input attributes, Running Status must remain unchanged.
+                // We still need to reset these
+                mPendingMessageIndex = 0;
+                mPendingMessageExpectedLength = 0;
+
+                return Complete;
+
+            // 2 bytes messages
+            case ProgramChange:
+            case AfterTouchChannel:
+            case TimeCodeQuarterFrame:
+            case SongSelect:
+                mPendingMessageExpectedLength = 2;
+                break;
+
+            // 3 bytes messages
+            case NoteOn:
+            case NoteOff:
+            case ControlChange:
+            case PitchBend:
+            case AfterTouchPoly:
+            case SongPosition:
+                mPendingMessageExpectedLength = 3;
+                break;
+
+            case SystemExclusiveStart:
+            case SystemExclusiveEnd:
+                if (!ioMessage.acquireSysEx())
+                {
+                    // No block left in the SysExPool, drop the message.
+                    reset();
+                    return Error;
+                }
+
+                // The message can be any length
+                // between 3 and MidiMessage::sSysExMaxSize bytes
+                mPendingMessageExpectedLength = MidiMessage::sSysExMaxSize;
+                mRunningStatus = InvalidType;
+                ioMessage.sysexArray[0] = pendingType;
+                break;
+
+            case InvalidType:
+            default:
+                // This is obviously wrong. Let's get the hell out'a here.
+                reset();
+                return Error;
+        }
+
+        if (unsigned(mPendingMessageIndex) + 1 >= mPendingMessageExpectedLength)
+        {
+            // Reception complete
+            ioMessage.type    = pendingType;
+            ioMessage.channel = getChannelFromStatusByte(mPendingMessage[0]);
+            ioMessage.data1   = mPendingMessage[1];
+            ioMessage.data2   = 0; // Completed new message has 1 data byte
+            ioMessage.length  = 1;
+
+            mPendingMessageIndex = 0;
+            mPendingMessageExpectedLength = 0;
+            ioMessage.valid = true;
+
+            return Complete;
+        }
+
+        // Waiting for more data
+        mPendingMessageIndex++;
+        return Pending;
+    }
+
+    // First, test if this is a status byte
+    if (inByte >= 0x80)
+    {
+        // Reception of status bytes in the middle of an uncompleted message
+        // are allowed only for interleaved Real Time message or EOX
+        switch (inByte)
+        {
+            case Clock:
+            case Start:
+            case Tick:
+            case Continue:
+            case Stop:
+            case ActiveSensing:
+            case SystemReset:
+
+                // Here we will have to extract the one-byte message,
+                // pass it to the structure for being read outside
+                // the MIDI class, and recompose the message it was
+                // interleaved into. Oh, and without killing the running status..
+                // This is done by leaving the pending message as is,
+                // it will be completed on next calls.
+
+                ioMessage.type    = (MidiType)inByte;
+                ioMessage.data1   = 0;
+                ioMessage.data2   = 0;
+                ioMessage.channel = 0;
+                ioMessage.length  = 1;
+                ioMessage.valid   = true;
+
+                return Complete;
+
+                // Exclusive
+            case SystemExclusiveStart:
+            case SystemExclusiveEnd:
+                if ((mPendingMessage[0] == SystemExclusiveStart)
+                ||  (mPendingMessage[0] == SystemExclusiveEnd))
+                {
+                    // Store the last byte (EOX)
+                    ioMessage.sysexArray[mPendingMessageIndex++] = inByte;
+                    ioMessage.type = SystemExclusive;
+
+                    // Get length
+                    ioMessage.data1   = mPendingMessageIndex & 0xff; // LSB
+                    ioMessage.data2   = byte(mPendingMessageIndex >> 8);   // MSB
+                    ioMessage.channel = 0;
+                    ioMessage.length  = mPendingMessageIndex;
+                    ioMessage.valid   = true;
+
+                    reset();
+                    return Complete;
+                }
+                else
+                {
+                    // Well well well.. error.
+                    reset();
+                    return Error;
+                }
+            // LCOV_EXCL_START - Coverage blind spot
+            default:
+                break;
+            // LCOV_EXCL_STOP
+        }
+    }
+
+    // Add extracted data byte to pending message
+    if ((mPendingMessage[0] == SystemExclusiveStart)
+    ||  (mPendingMessage[0] == SystemExclusiveEnd))
+        ioMessage.sysexArray[mPendingMessageIndex] = inByte;
+    else
+        mPendingMessage[mPendingMessageIndex] = inByte;
+
+    // Now we are going to check if we have reached the end of the message
+    if (unsigned(mPendingMessageIndex) + 1 >= mPendingMessageExpectedLength)
+    {
+        // SysEx larger than the allocated buffer size,
+        // Split SysEx like so:
+        //   first:  0xF0 .... 0xF0
+        //   midlle: 0xF7 .... 0xF0
+        //   last:   0xF7 .... 0xF7
+        if ((mPendingMessage[0] == SystemExclusiveStart)
+        ||  (mPendingMessage[0] == SystemExclusiveEnd))
+        {
+            // Keep the last byte for the next chunk, the other
+            // pending bytes are not used by SysEx.
+            mPendingMessage[1] = ioMessage.sysexArray[SysExMaxSize - 1];
+            ioMessage.sysexArray[SysExMaxSize - 1] = SystemExclusiveStart;
+            ioMessage.type = SystemExclusive;
+
+            // Get length
+            ioMessage.data1   = SysExMaxSize & 0xff; // LSB
+            ioMessage.data2   = byte(SysExMaxSize >> 8); // MSB
+            ioMessage.channel = 0;
+            ioMessage.length  = SysExMaxSize;
+            ioMessage.valid   = true;
+
+            return SysExChunk;
+        }
+
+        ioMessage.type = getTypeFromStatusByte(mPendingMessage[0]);
+
+        if (isChannelMessage(ioMessage.type))
+            ioMessage.channel = getChannelFromStatusByte(mPendingMessage[0]);
+        else
+            ioMessage.channel = 0;
+
+        ioMessage.data1 = mPendingMessage[1];
+        // Save data2 only if applicable
+        ioMessage.data2 = mPendingMessageExpectedLength == 3 ? mPendingMessage[2] : 0;
+        ioMessage.length = mPendingMessageExpectedLength;
+
+        // Reset local variables
+        mPendingMessageIndex = 0;
+        mPendingMessageExpectedLength = 0;
+
+        ioMessage.valid = true;
+
+        // Activate running status (if enabled for the received type)
+        switch (ioMessage.type)
+        {
+            case NoteOff:
+            case NoteOn:
+            case AfterTouchPoly:
+            case ControlChange:
+            case ProgramChange:
+            case AfterTouchChannel:
+            case PitchBend:
+                // Running status enabled: store it from received message
+                mRunningStatus = mPendingMessage[0];
+                break;
+
+            default:
+                // No running status
+                mRunningStatus = InvalidType;
+                break;
+        }
+        return Complete;
+    }
+
+    // Then update the index of the pending message.
+    mPendingMessageIndex++;
+    return Pending;
+}
+
+/*! \brief Start the next chunk of a split SysEx message.
+ Must be called after a SysExChunk status, once the chunk has been consumed
+ and before parsing the next byte.
+ */
+template<unsigned SysExMaxSize, class SysExPool>
+inline void Parser<SysExMaxSize, SysExPool>::continueSysEx(MidiMessage& ioMessage)
+{
+    ioMessage.sysexArray[0] = SystemExclusiveEnd;
+    ioMessage.sysexArray[1] = mPendingMessage[1];
+
+    mPendingMessageIndex = 2;
+}
+
+/*! \brief True while a SysEx is being received, its data is then still
+ being written to the message.
+ */
+template<unsigned SysExMaxSize, class SysExPool>
+inline bool Parser<SysExMaxSize, SysExPool>::isReceivingSysEx() const
+{
+    return mPendingMessageIndex != 0 &&
+          (mPendingMessage[0] == SystemExclusiveStart || mPendingMessage[0] == SystemExclusiveEnd);
+}
+
+/*! \brief Drop the pending message and the running status.
+ */
+template<unsigned SysExMaxSize, class SysExPool>
+inline void Parser<SysExMaxSize, SysExPool>::reset()
+{
+    mPendingMessageIndex = 0;
+    mPendingMessageExpectedLength = 0;
+    mRunningStatus = InvalidType;
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Extract an enumerated MIDI type from a status byte.
+
+ This is a utility static method, used internally,
+ made public so you can handle MidiTypes more easily.
+ */
+template<unsigned SysExMaxSize, class SysExPool>
+inline MidiType Parser<SysExMaxSize, SysExPool>::getTypeFromStatusByte(byte inStatus)
+{
+    if ((inStatus  < 0x80) ||
+        (inStatus == Undefined_F4) ||
+        (inStatus == Undefined_F5) ||
+        (inStatus == Undefined_FD))
+        return InvalidType; // Data bytes and undefined.
+
+    if (inStatus < 0xf0)
+        // Channel message, remove channel nibble.
+        return MidiType(inStatus & 0xf0);
+
+    return MidiType(inStatus);
+}
+
+/*! \brief Returns channel in the range 1-16
+ */
+template<unsigned SysExMaxSize, class SysExPool>
+inline Channel Parser<SysExMaxSize, SysExPool>::getChannelFromStatusByte(byte inStatus)
+{
+    return Channel((inStatus & 0x0f) + 1);
+}
+
+template<unsigned SysExMaxSize, class SysExPool>
+inline bool Parser<SysExMaxSize, SysExPool>::isChannelMessage(MidiType inType)
+{
+    return (inType == NoteOff           ||
+            inType == NoteOn            ||
+            inType == ControlChange     ||
+            inType == AfterTouchPoly    ||
+            inType == AfterTouchChannel ||
+            inType == PitchBend         ||
+            inType == ProgramChange);
+}
+
+END_MIDI_NAMESPACE
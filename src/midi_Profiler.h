@@ -0,0 +1,157 @@
+/*!
+ *  @file       midi_Profiler.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Handler execution time statistics
+ *  @author     Francois Best, lathoub
+ *  @date       19/10/26
+ *  @license    MIT - Copyright (c) 2015 Francois Best
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "midi_Defs.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Execution time statistics of the handler for a message type.
+ Times are in Platform::now() units: use a Platform returning micros() to
+ profile short handlers.
+ */
+struct HandlerStats
+{
+    unsigned long count;    ///< Number of calls.
+    unsigned long total;    ///< Cumulated time.
+    unsigned long minimum;  ///< Shortest call.
+    unsigned long maximum;  ///< Longest call.
+    unsigned long average;  ///< Exponentially weighted average, over about 8 calls.
+};
+
+/*! \brief Times the handler calls made for each message type,
+ see Settings::UseHandlerProfiler.
+ */
+template<class Platform, bool Enabled>
+class HandlerProfiler
+{
+public:
+    inline HandlerProfiler()
+    {
+        reset();
+    }
+
+public:
+    inline unsigned long start() const
+    {
+        return Platform::now();
+    }
+
+    inline void stop(MidiType inType, unsigned long inStartTime)
+    {
+        const unsigned long elapsed = Platform::now() - inStartTime;
+        Entry& entry = mEntries[getIndex(inType)];
+
+        if (entry.count == 0)
+        {
+            entry.minimum = elapsed;
+            entry.maximum = elapsed;
+            entry.scaledAverage = elapsed << sAverageShift;
+        }
+        else
+        {
+            if (elapsed < entry.minimum)
+                entry.minimum = elapsed;
+            if (elapsed > entry.maximum)
+                entry.maximum = elapsed;
+            entry.scaledAverage -= entry.scaledAverage >> sAverageShift;
+            entry.scaledAverage += elapsed;
+        }
+        entry.count++;
+        entry.total += elapsed;
+    }
+
+    inline HandlerStats getStats(MidiType inType) const
+    {
+        HandlerStats stats = { 0, 0, 0, 0, 0 };
+        if (inType < NoteOff)
+            return stats;
+
+        const Entry& entry = mEntries[getIndex(inType)];
+        stats.count   = entry.count;
+        stats.total   = entry.total;
+        stats.minimum = entry.minimum;
+        stats.maximum = entry.maximum;
+        stats.average = entry.scaledAverage >> sAverageShift;
+        return stats;
+    }
+
+    inline void reset()
+    {
+        for (unsigned i = 0; i < sNumTypes; ++i)
+        {
+            mEntries[i].count         = 0;
+            mEntries[i].total         = 0;
+            mEntries[i].minimum       = 0;
+            mEntries[i].maximum       = 0;
+            mEntries[i].scaledAverage = 0;
+        }
+    }
+
+private:
+    // Same layout as the callback table: one entry per channel
+    // message type, then one per system message type.
+    static const unsigned sNumTypes = 7 + 16;
+
+    // The average is stored multiplied by 8, and moves by 1/8th
+    // of the difference to each new sample.
+    static const unsigned sAverageShift = 3;
+
+    static inline unsigned getIndex(MidiType inType)
+    {
+        return inType < SystemExclusive ? unsigned(inType >> 4) - 8
+                                        : unsigned(inType - SystemExclusive) + 7;
+    }
+
+    struct Entry
+    {
+        unsigned long count;
+        unsigned long total;
+        unsigned long minimum;
+        unsigned long maximum;
+        unsigned long scaledAverage;
+    };
+
+    Entry mEntries[sNumTypes];
+};
+
+template<class Platform>
+class HandlerProfiler<Platform, false>
+{
+public:
+    inline unsigned long start() const { return 0; }
+    inline void stop(MidiType, unsigned long) {}
+    inline HandlerStats getStats(MidiType) const
+    {
+        HandlerStats stats = { 0, 0, 0, 0, 0 };
+        return stats;
+    }
+    inline void reset() {}
+};
+
+END_MIDI_NAMESPACE
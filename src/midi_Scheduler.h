@@ -0,0 +1,160 @@
+/*!
+ *  @file       midi_Scheduler.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Scheduled output
+ *  @author     Francois Best, lathoub
+ *  @date       19/10/26
+ *  @license    MIT - Copyright (c) 2015 Francois Best
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "midi_Defs.h"
+#include "midi_PackedMessage.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Messages waiting for their time to be sent, see Settings::ScheduleMaxSize.
+
+ A min-heap ordered by time, messages scheduled for the same time keep
+ their order. Times are compared so that Platform::now() wrapping around
+ is handled, as long as messages are scheduled less than half its range
+ ahead (about 24 days in milliseconds).
+ */
+template<unsigned Size>
+class Scheduler
+{
+public:
+    typedef typename SizeType<Size>::type Index;
+
+public:
+    inline Scheduler()
+        : mCount(0)
+        , mNextOrder(0)
+    {
+    }
+
+public:
+    /*! \return false if the schedule is full or the message invalid,
+     it is then dropped.
+     */
+    inline bool push(unsigned long inTime, PackedMessage inMessage)
+    {
+        if (mCount == Size || !inMessage.valid())
+            return false;
+
+        const Entry entry = { inTime, inMessage, mNextOrder++ };
+
+        // Move the entry up from the end of the heap
+        unsigned index = mCount++;
+        while (index > 0)
+        {
+            const unsigned parent = (index - 1) / 2;
+            if (!isBefore(entry, mEntries[parent]))
+                break;
+            mEntries[index] = mEntries[parent];
+            index = parent;
+        }
+        mEntries[index] = entry;
+        return true;
+    }
+
+    /*! \brief Get the earliest message if its time has come, without
+     removing it (see pop).
+     \return false if no message is due.
+     */
+    inline bool peek(unsigned long inNow, PackedMessage& outMessage) const
+    {
+        if (mCount == 0 || long(inNow - mEntries[0].time) < 0)
+            return false;
+
+        outMessage = mEntries[0].message;
+        return true;
+    }
+
+    /*! \brief Remove the earliest message, once it has been sent.
+     */
+    inline void pop()
+    {
+        if (mCount == 0)
+            return;
+
+        // Move the last entry down from the top of the heap
+        const Entry last = mEntries[--mCount];
+        unsigned index = 0;
+        for (;;)
+        {
+            unsigned child = 2 * index + 1;
+            if (child >= mCount)
+                break;
+            if (child + 1 < mCount && isBefore(mEntries[child + 1], mEntries[child]))
+                ++child;
+            if (!isBefore(mEntries[child], last))
+                break;
+            mEntries[index] = mEntries[child];
+            index = child;
+        }
+        mEntries[index] = last;
+    }
+
+    inline unsigned size() const
+    {
+        return mCount;
+    }
+
+    inline void clear()
+    {
+        mCount = 0;
+    }
+
+private:
+    struct Entry
+    {
+        unsigned long time;
+        PackedMessage message;
+        uint16_t order;
+    };
+
+    static inline bool isBefore(const Entry& inA, const Entry& inB)
+    {
+        const long delta = long(inA.time - inB.time);
+        return delta < 0 || (delta == 0 && int16_t(inA.order - inB.order) < 0);
+    }
+
+private:
+    Entry mEntries[Size];
+    Index mCount;
+    uint16_t mNextOrder;
+};
+
+template<>
+class Scheduler<0>
+{
+public:
+    inline bool push(unsigned long, PackedMessage) { return false; }
+    inline bool peek(unsigned long, PackedMessage&) const { return false; }
+    inline void pop() {}
+    inline unsigned size() const { return 0; }
+    inline void clear() {}
+};
+
+END_MIDI_NAMESPACE
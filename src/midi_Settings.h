@@ -55,6 +55,25 @@ struct DefaultSettings
     */
     static const bool UseRunningStatus = false;
 
+    /*! Send NoteOff messages as NoteOn with 0 velocity, so that notes starting
+    and ending on the same channel share the running status.\n
+    The release velocity is lost, only enable it if the receivers ignore it.
+    */
+    static const bool SendNoteOffAsNullVelocityNoteOn = false;
+
+    /*! With running status, send the status byte again when it was last sent
+    more than this many milliseconds ago, for receivers that start listening
+    in the middle of a stream.
+    Set to 0 to only send the status byte when it changes.
+    */
+    static const uint16_t RunningStatusRefreshPeriod = 0;
+
+    /*! With running status, send the status byte again after this many
+    messages were sent without it.
+    Set to 0 to only send the status byte when it changes.
+    */
+    static const unsigned RunningStatusRefreshCount = 0;
+
     /*! NoteOn with 0 velocity should be handled as NoteOf.\n
     Set to true  to get NoteOff events when receiving null-velocity NoteOn messages.\n
     Set to false to get NoteOn  events when receiving null-velocity NoteOn messages.
@@ -72,6 +91,85 @@ struct DefaultSettings
     */
     static const unsigned SysExMaxSize = 128;
 
+    /*! Storage of received SysEx messages. void gives each interface its own
+    array of SysExMaxSize bytes. Set to a SysExPool type to have interfaces
+    borrow blocks from a pool shared between them, only while a SysEx is
+    received (eg: typedef SysExPool<256, 2> SysExPool;).
+    Pooled SysEx data is only valid until the next read, even in copies of
+    the message.
+    */
+    typedef void SysExPool;
+
+    /*! Maximum number of channel-specific callbacks (eg: NoteOn on channel 10
+    only) that can be bound at once. Each one costs three pointers and two bytes
+    of RAM. Set to 0 to disable per-channel routing: binding a channel-specific
+    callback then fails to compile. When the pool is full, further bindings
+    are dropped (see MidiInterface::hasChannelHandle).
+    */
+    static const unsigned MaxChannelCallbacks = 0;
+
+    /*! Maximum number of received events kept for block-based delivery
+    (see MidiInterface::takeBlock). Each event costs 8 bytes of RAM on AVR.
+    Set to 0 to disable block-based delivery.
+    */
+    static const unsigned EventBlockMaxSize = 0;
+
+    /*! Number of Platform::now() ticks per second, used to convert reception
+    times to sample offsets in MidiInterface::takeBlock.
+    Use 1000 for millis() (the default platform), 1000000 for micros().
+    */
+    static const unsigned long PlatformTicksPerSecond = 1000;
+
+    /*! Set to true to time each handler call with Platform::now(), and keep
+    statistics per message type (see MidiInterface::getHandlerStats).
+    Costs 20 bytes of RAM per message type on AVR.
+    */
+    static const bool UseHandlerProfiler = false;
+
+    /*! Size in bytes of the transmit queue. When not 0, the send methods queue
+    messages whole and return immediately, and MidiInterface::pump writes
+    them to the transport. Each message takes 2 more bytes (3 above 255).
+    A message longer than TxQueueSize minus those bytes (eg: a long SysEx) can
+    never be queued and is always rejected (see MidiInterface::isSendAccepted):
+    size the queue for the longest message, or send long SysEx in chunks with
+    MidiInterface::sendPacedSysEx, each chunk being queued on its own.
+    Set to 0 to write messages directly to the transport.
+    */
+    static const unsigned TxQueueSize = 0;
+
+    /*! Size in bytes of the real-time queue, used with a transmit queue.
+    When not 0, real-time messages (Clock, Start, Stop...) skip the messages
+    waiting in the transmit queue. MidiInterface::pump writes them at the next
+    byte boundary, even in the middle of a message (eg: a long SysEx), when the
+    transport is a byte stream (eg: SerialMIDI, see TransportAdapter), and
+    between messages otherwise. Messages are then pumped one byte at a time
+    to byte streams.
+    Set to 0 to queue real-time messages in order with the others.
+    */
+    static const unsigned RealTimeQueueSize = 0;
+
+    /*! Set to true to skip sending Control Change, Program Change, channel
+    pressure and Pitch Bend messages that repeat the last value sent on their
+    channel (see MidiInterface::invalidateOutputCache).
+    Costs about 2 KB of RAM (the values of the 16 channels), which is all
+    the RAM of ATmega328 boards (eg: Uno, Nano): keep it for larger ones.
+    */
+    static const bool UseOutputCache = false;
+
+    /*! Set to true to send SysEx in chunks spaced in time, for receivers that
+    drop data otherwise (see MidiInterface::sendPacedSysEx, which requires it).
+    While a frame is sent, Thru only echoes real-time messages: the others
+    are dropped, not delayed, until the frame ends.
+    Costs about 20 bytes of RAM.
+    */
+    static const bool UsePacedSysEx = false;
+
+    /*! Maximum number of messages scheduled for later (see
+    MidiInterface::sendAt). Each one costs 10 bytes of RAM on AVR.
+    Set to 0 to disable scheduling.
+    */
+    static const unsigned ScheduleMaxSize = 0;
+
     /*! Global switch to turn on/off sender ActiveSensing
     Set to true to send ActiveSensing
     Set to false will not send ActiveSensing message (will also save memory)
@@ -0,0 +1,182 @@
+/*!
+ *  @file       midi_SysExPool.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - SysEx blocks shared between interfaces
+ *  @author     Francois Best, lathoub
+ *  @date       19/10/26
+ *  @license    MIT - Copyright (c) 2015 Francois Best
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "midi_Defs.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Fixed set of SysEx blocks, shared by all the interfaces using it.
+
+ Interfaces borrow a block when they start receiving a SysEx message, and
+ give it back on the next read once it has been dispatched (even if no more
+ data arrives), so RAM scales with the number
+ of SysEx messages received at the same time rather than with the number of
+ ports. Enable it in the Settings of each interface:
+ \code{.cpp}
+ struct PooledSettings : public midi::DefaultSettings
+ {
+     typedef midi::SysExPool<256, 2> SysExPool; // 2 blocks of 256 bytes
+     static const unsigned SysExMaxSize = 256;
+ };
+ \endcode
+ Blocks are taken and given back atomically (with a short critical section
+ on cores without atomic instructions), interfaces can be served from
+ different threads or interrupts.
+ \warning A block is given back when the interface reads again:
+ copies of a pooled message do not keep their SysEx data alive.
+ */
+template<unsigned BlockSize, unsigned NumBlocks>
+class SysExPool
+{
+    static_assert(NumBlocks > 0 && NumBlocks <= 16, "SysExPool holds 1 to 16 blocks");
+
+public:
+    static const unsigned sBlockSize = BlockSize;
+    static const unsigned sNumBlocks = NumBlocks;
+
+public:
+    /*! \brief Borrow a free block.
+     \return nullptr if all blocks are in use.
+     */
+    static inline DataByte* acquire()
+    {
+        for (unsigned i = 0; i < NumBlocks; ++i)
+        {
+            if (tryTake(uint16_t(1u << i)))
+                return sBlocks[i];
+        }
+        return nullptr;
+    }
+
+    /*! \brief Give a borrowed block back.
+     */
+    static inline void release(DataByte* inBlock)
+    {
+        const unsigned index = unsigned(inBlock - sBlocks[0]) / BlockSize;
+        give(uint16_t(1u << index));
+    }
+
+    /*! \brief Number of blocks currently free.
+     */
+    static inline unsigned available()
+    {
+        const uint16_t used = load();
+        unsigned count = 0;
+        for (unsigned i = 0; i < NumBlocks; ++i)
+            count += (used & (1u << i)) ? 0 : 1;
+        return count;
+    }
+
+private:
+#if defined(__AVR__)
+    // Single core: a short critical section is enough.
+    static inline uint16_t load()
+    {
+        const uint8_t sreg = SREG;
+        cli();
+        const uint16_t used = sUsed;
+        SREG = sreg;
+        return used;
+    }
+    static inline bool tryTake(uint16_t inBit)
+    {
+        const uint8_t sreg = SREG;
+        cli();
+        const bool taken = (sUsed & inBit) == 0;
+        sUsed |= inBit;
+        SREG = sreg;
+        return taken;
+    }
+    static inline void give(uint16_t inBit)
+    {
+        const uint8_t sreg = SREG;
+        cli();
+        sUsed &= uint16_t(~inBit);
+        SREG = sreg;
+    }
+#elif defined(__arm__) && !defined(__ARM_FEATURE_LDREX)
+    // ARMv6-M (Cortex-M0/M0+) has no exclusive access instructions, atomic
+    // read-modify-write builtins would become libatomic calls: mask interrupts.
+    // This only guards against interrupts of the same core: on dual-core parts
+    // (eg: RP2040), serve the interfaces sharing a pool from a single core.
+    static inline uint32_t disableInterrupts()
+    {
+        uint32_t primask;
+        __asm__ volatile ("mrs %0, primask\n\tcpsid i" : "=r" (primask) :: "memory");
+        return primask;
+    }
+    static inline void restoreInterrupts(uint32_t inPrimask)
+    {
+        __asm__ volatile ("msr primask, %0" :: "r" (inPrimask) : "memory");
+    }
+    static inline uint16_t load()
+    {
+        return __atomic_load_n(&sUsed, __ATOMIC_ACQUIRE);
+    }
+    static inline bool tryTake(uint16_t inBit)
+    {
+        const uint32_t primask = disableInterrupts();
+        const bool taken = (sUsed & inBit) == 0;
+        sUsed = uint16_t(sUsed | inBit);
+        restoreInterrupts(primask);
+        return taken;
+    }
+    static inline void give(uint16_t inBit)
+    {
+        const uint32_t primask = disableInterrupts();
+        sUsed = uint16_t(sUsed & ~inBit);
+        restoreInterrupts(primask);
+    }
+#else
+    static inline uint16_t load()
+    {
+        return __atomic_load_n(&sUsed, __ATOMIC_ACQUIRE);
+    }
+    static inline bool tryTake(uint16_t inBit)
+    {
+        return (__atomic_fetch_or(&sUsed, inBit, __ATOMIC_ACQUIRE) & inBit) == 0;
+    }
+    static inline void give(uint16_t inBit)
+    {
+        __atomic_fetch_and(&sUsed, uint16_t(~inBit), __ATOMIC_RELEASE);
+    }
+#endif
+
+private:
+    static DataByte sBlocks[NumBlocks][BlockSize];
+    static uint16_t sUsed;
+};
+
+template<unsigned BlockSize, unsigned NumBlocks>
+DataByte SysExPool<BlockSize, NumBlocks>::sBlocks[NumBlocks][BlockSize];
+
+template<unsigned BlockSize, unsigned NumBlocks>
+uint16_t SysExPool<BlockSize, NumBlocks>::sUsed = 0;
+
+END_MIDI_NAMESPACE
@@ -0,0 +1,171 @@
+/*!
+ *  @file       midi_Transport.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Optional transport features
+ *  @author     Francois Best, lathoub
+ *  @date       19/10/26
+ *  @license    MIT - Copyright (c) 2015 Francois Best
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "midi_Defs.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Calls to the optional parts of the transport contract.
+
+ Besides begin, beginTransmission, write, endTransmission, read and
+ available, a transport can provide:
+ \code{.cpp}
+ bool beginTransmission(MidiType inType, unsigned inSizeHint);
+ void write(const byte* inData, size_t inLength);
+ \endcode
+ The first one is called instead of beginTransmission(MidiType) with the
+ number of bytes about to be written (an upper bound), eg: to size a packet.
+ The second one writes contiguous bytes at once, eg: a whole message or a
+ SysEx payload, instead of one call per byte.
+ A transport sending bytes as they come (eg: a serial port) can also declare
+ \code{.cpp}
+ static const bool isByteStream = true;
+ \endcode
+ so that real-time bytes can be written in the middle of another message
+ (see Settings::RealTimeQueueSize). Packet-based transports must not.
+ Each call picks the transport's own method if it has one, and falls back
+ on the mandatory methods otherwise.
+ */
+struct TransportAdapter
+{
+    template<class Transport>
+    static inline bool beginTransmission(Transport& ioTransport, MidiType inType, unsigned inSizeHint)
+    {
+        return beginTransmission(ioTransport, inType, inSizeHint, 0);
+    }
+
+    template<class Transport>
+    static inline void write(Transport& ioTransport, const byte* inData, size_t inLength)
+    {
+        write(ioTransport, inData, inLength, 0);
+    }
+
+    // True if the transport has a bulk write method.
+    template<class Transport>
+    struct HasBulkWrite
+    {
+        template<class T> static T& make();
+        template<class T> static char test(decltype(make<T>().write(static_cast<const byte*>(nullptr), size_t(0)), 0)*);
+        template<class T> static long test(...);
+        static const bool value = sizeof(test<Transport>(nullptr)) == sizeof(char);
+    };
+
+    // True if the transport declares itself a byte stream.
+    template<class Transport>
+    struct IsByteStream
+    {
+        template<class T> static constexpr bool test(decltype(T::isByteStream)*) { return T::isByteStream; }
+        template<class T> static constexpr bool test(...) { return false; }
+        static const bool value = test<Transport>(nullptr);
+    };
+
+private:
+    template<class Transport>
+    static inline auto beginTransmission(Transport& ioTransport, MidiType inType, unsigned inSizeHint, int)
+        -> decltype(ioTransport.beginTransmission(inType, inSizeHint))
+    {
+        return ioTransport.beginTransmission(inType, inSizeHint);
+    }
+
+    template<class Transport>
+    static inline bool beginTransmission(Transport& ioTransport, MidiType inType, unsigned, long)
+    {
+        return ioTransport.beginTransmission(inType);
+    }
+
+    template<class Transport>
+    static inline auto write(Transport& ioTransport, const byte* inData, size_t inLength, int)
+        -> decltype(ioTransport.write(inData, inLength), void())
+    {
+        ioTransport.write(inData, inLength);
+    }
+
+    template<class Transport>
+    static inline void write(Transport& ioTransport, const byte* inData, size_t inLength, long)
+    {
+        for (size_t i = 0; i < inLength; ++i)
+            ioTransport.write(inData[i]);
+    }
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Bytes of the message being sent, written at once to transports with
+ a bulk write (see TransportAdapter). Empty for other transports.
+ Long enough for any message but SysEx, which payload is written directly.
+ */
+template<bool Enabled>
+class TxChunk
+{
+public:
+    static const unsigned sSize = 3;
+
+public:
+    inline TxChunk()
+        : mLength(0)
+    {
+    }
+
+    inline bool full() const
+    {
+        return mLength == sSize;
+    }
+
+    inline void push(byte inByte)
+    {
+        mData[mLength++] = inByte;
+    }
+
+    template<class Transport>
+    inline void flush(Transport& ioTransport)
+    {
+        if (mLength > 0)
+        {
+            TransportAdapter::write(ioTransport, mData, mLength);
+            mLength = 0;
+        }
+    }
+
+private:
+    byte mData[sSize];
+    uint8_t mLength;
+};
+
+template<>
+class TxChunk<false>
+{
+public:
+    inline bool full() const { return false; }
+    inline void push(byte) {}
+
+    template<class Transport>
+    inline void flush(Transport&) {}
+};
+
+END_MIDI_NAMESPACE
@@ -0,0 +1,392 @@
+/*!
+ *  @file       midi_TxQueue.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Transmit queue
+ *  @author     Francois Best, lathoub
+ *  @date       19/10/26
+ *  @license    MIT - Copyright (c) 2015 Francois Best
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "midi_Defs.h"
+#include "midi_Transport.h"
+
+BEGIN_MIDI_NAMESPACE
+
+// Indexes shared between the sender and pump(), which can run in different
+// threads or interrupts.
+struct TxAtomic
+{
+#if defined(__AVR__)
+    // Single core: a short critical section is enough.
+    template<class Index>
+    static inline Index load(const volatile Index& inIndex)
+    {
+        const uint8_t sreg = SREG;
+        cli();
+        const Index value = inIndex;
+        SREG = sreg;
+        return value;
+    }
+    template<class Index>
+    static inline void store(volatile Index& outIndex, Index inValue)
+    {
+        const uint8_t sreg = SREG;
+        cli();
+        outIndex = inValue;
+        SREG = sreg;
+    }
+#else
+    template<class Index>
+    static inline Index load(const volatile Index& inIndex)
+    {
+        return __atomic_load_n(&inIndex, __ATOMIC_ACQUIRE);
+    }
+    template<class Index>
+    static inline void store(volatile Index& outIndex, Index inValue)
+    {
+        __atomic_store_n(&outIndex, inValue, __ATOMIC_RELEASE);
+    }
+#endif
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Ring buffer of outgoing real-time bytes, see Settings::RealTimeQueueSize.
+ */
+template<unsigned Size>
+class TxRealTimeQueue
+{
+public:
+    typedef typename SizeType<Size>::type Index;
+
+public:
+    inline TxRealTimeQueue()
+        : mHead(0)
+        , mTail(0)
+    {
+    }
+
+public:
+    /*! \return false if the queue is full, the byte is then dropped.
+     */
+    inline bool push(byte inByte)
+    {
+        const Index head = mHead;
+        const Index next = Index((head + 1) % Size);
+        if (next == TxAtomic::load(mTail))
+            return false;
+
+        mBuffer[head] = inByte;
+        TxAtomic::store(mHead, next);
+        return true;
+    }
+
+    inline bool pop(byte& outByte)
+    {
+        const Index tail = mTail;
+        if (tail == TxAtomic::load(mHead))
+            return false;
+
+        outByte = mBuffer[tail];
+        TxAtomic::store(mTail, Index((tail + 1) % Size));
+        return true;
+    }
+
+    inline bool empty() const
+    {
+        return TxAtomic::load(mTail) == TxAtomic::load(mHead);
+    }
+
+private:
+    byte mBuffer[Size];
+    volatile Index mHead;
+    volatile Index mTail;
+};
+
+template<>
+class TxRealTimeQueue<0>
+{
+public:
+    inline bool push(byte) { return false; }
+    inline bool pop(byte&) { return false; }
+    inline bool empty() const { return true; }
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Ring buffer of outgoing messages, see Settings::TxQueueSize.
+
+ Messages are queued whole by the send methods, each one behind a small
+ header (type and length), and only become visible to pump() once complete.
+ Messages of a batch (see MidiInterface::beginBatch) share a single header,
+ and are pumped in a single transmission.
+ A message that does not fit in the free space is rejected as a whole.
+ pump() writes queued bytes to the transport, calling beginTransmission
+ and endTransmission around each message, and can stop in the middle of a
+ message to resume on the next call.
+
+ Real-time bytes pushed with pushRealTime skip the queued messages. pump()
+ writes them at the next byte boundary, even in the middle of a message, to
+ byte stream transports (see TransportAdapter::IsByteStream), and between
+ messages to the others (see Settings::RealTimeQueueSize).
+
+ The send methods and pump() can run in different threads or interrupts
+ (one of each, real-time bytes can be pushed from a third one), the queue
+ has no locks.
+ */
+template<unsigned Size, unsigned RealTimeSize = 0>
+class TxQueue
+{
+public:
+    typedef typename SizeType<Size>::type Index;
+
+    /*! Bytes used by the header of each message in the queue.
+     */
+    static const unsigned sHeaderSize = 1 + sizeof(Index);
+
+public:
+    inline TxQueue()
+        : mHead(0)
+        , mTail(0)
+        , mWrite(0)
+        , mMessageStart(0)
+        , mRemaining(0)
+        , mSkipMessage(false)
+        , mAccepted(true)
+    {
+    }
+
+public:
+    /*! \brief Reserve room for a message of up to inMaxLength bytes.
+     \return false if the message does not fit, it is then rejected.
+     */
+    inline bool reserve(MidiType inType, unsigned inMaxLength)
+    {
+        if (!accept(inMaxLength + sHeaderSize <= available()))
+            return false;
+
+        mMessageStart = mHead;
+        mWrite = mHead;
+        put(byte(inType));
+        for (unsigned i = 0; i < sizeof(Index); ++i)
+            put(0); // Length, set by commit
+        return true;
+    }
+
+    inline void push(byte inByte)
+    {
+        put(inByte);
+    }
+
+    /*! \brief Reserve room for inMaxLength more bytes in the current message.
+     \return false if they do not fit, the extra bytes are then rejected.
+     */
+    inline bool extend(unsigned inMaxLength)
+    {
+        return accept(inMaxLength <= available());
+    }
+
+    /*! \brief Push a real-time byte, written by pump() before queued messages.
+     \return false if it does not fit, it is then rejected.
+     */
+    inline bool pushRealTime(byte inByte)
+    {
+        return accept(mRealTime.push(inByte));
+    }
+
+    /*! \brief Make the reserved message visible to pump().
+     */
+    inline void commit()
+    {
+        // Write the actual length in the header
+        Index length = Index(distance(mMessageStart, mWrite) - sHeaderSize);
+        Index position = mMessageStart;
+        advance(position);
+        for (unsigned i = 0; i < sizeof(Index); ++i)
+        {
+            mBuffer[position] = byte(length & 0xff);
+            length = Index(length >> 8);
+            advance(position);
+        }
+        store(mHead, mWrite);
+    }
+
+    /*! \brief Free space in bytes, headers included.
+     */
+    inline unsigned available() const
+    {
+        // One byte is kept free to tell a full queue from an empty one.
+        return Size - 1 - distance(load(mTail), mWrite);
+    }
+
+    /*! \brief False if the last message had to be rejected.
+     */
+    inline bool isAccepted() const
+    {
+        return TxAtomic::load(mAccepted);
+    }
+
+    inline bool empty() const
+    {
+        return load(mTail) == load(mHead) && mRealTime.empty();
+    }
+
+    /*! \brief Write up to inMaxBytes queued bytes to the transport.
+     \return The number of bytes written.
+     */
+    template<class Transport>
+    unsigned pump(Transport& ioTransport, unsigned inMaxBytes)
+    {
+        static const bool sByteStream = TransportAdapter::IsByteStream<Transport>::value;
+        const Index head = load(mHead);
+        Index tail = mTail;
+        unsigned written = 0;
+
+        while (written < inMaxBytes)
+        {
+            // Real-time bytes can be written between any two bytes of a byte
+            // stream, other transports get them between messages.
+            const bool inMessage = mRemaining != 0 && !mSkipMessage;
+            byte realTime;
+            if ((!inMessage || sByteStream) && mRealTime.pop(realTime))
+            {
+                if (inMessage || TransportAdapter::beginTransmission(ioTransport, MidiType(realTime), 1))
+                {
+                    TransportAdapter::write(ioTransport, &realTime, 1);
+                    if (!inMessage)
+                        ioTransport.endTransmission();
+                    ++written;
+                }
+                continue;
+            }
+
+            if (tail == head)
+                break;
+
+            if (mRemaining == 0)
+            {
+                // Start of a message: read its header
+                const MidiType type = MidiType(mBuffer[tail]);
+                advance(tail);
+
+                Index length = 0;
+                for (unsigned i = 0; i < sizeof(Index); ++i)
+                {
+                    length = Index(length | (Index(mBuffer[tail]) << (8 * i)));
+                    advance(tail);
+                }
+                mRemaining = length;
+                mSkipMessage = !TransportAdapter::beginTransmission(ioTransport, type, length);
+                if (mRemaining == 0 && !mSkipMessage)
+                    ioTransport.endTransmission();
+                continue;
+            }
+
+            // Write the bytes of the message that are contiguous in the buffer,
+            // one at a time when real-time bytes may have to come in between.
+            unsigned count = (RealTimeSize && sByteStream) ? 1 : mRemaining;
+            if (count > unsigned(Size - tail))
+                count = unsigned(Size - tail);
+            if (!mSkipMessage)
+            {
+                if (count > inMaxBytes - written)
+                    count = inMaxBytes - written;
+                TransportAdapter::write(ioTransport, mBuffer + tail, count);
+                written += count;
+            }
+            tail = Index((tail + count) % Size);
+            mRemaining = Index(mRemaining - count);
+
+            if (mRemaining == 0 && !mSkipMessage)
+                ioTransport.endTransmission();
+        }
+
+        store(mTail, tail);
+        return written;
+    }
+
+private:
+    // Real-time bytes can be pushed from another context than the messages:
+    // the result of the last push is stored atomically.
+    inline bool accept(bool inAccepted)
+    {
+        TxAtomic::store(mAccepted, inAccepted);
+        return inAccepted;
+    }
+
+    inline void put(byte inByte)
+    {
+        mBuffer[mWrite] = inByte;
+        advance(mWrite);
+    }
+
+    static inline void advance(Index& ioIndex)
+    {
+        if (++ioIndex == Size)
+            ioIndex = 0;
+    }
+
+    static inline unsigned distance(Index inFrom, Index inTo)
+    {
+        return inTo >= inFrom ? unsigned(inTo - inFrom) : unsigned(Size - inFrom + inTo);
+    }
+
+    static inline Index load(const volatile Index& inIndex)
+    {
+        return TxAtomic::load(inIndex);
+    }
+    static inline void store(volatile Index& outIndex, Index inValue)
+    {
+        TxAtomic::store(outIndex, inValue);
+    }
+
+private:
+    byte mBuffer[Size];
+    volatile Index mHead;       // End of the committed messages, written by the sender
+    volatile Index mTail;       // Next byte to pump, written by pump()
+    Index mWrite;               // End of the message being queued
+    Index mMessageStart;        // Header of the message being queued
+    Index mRemaining;           // Bytes left to pump in the current message
+    bool mSkipMessage;          // The transport refused the current message
+    volatile bool mAccepted;
+    TxRealTimeQueue<RealTimeSize> mRealTime;
+};
+
+template<unsigned RealTimeSize>
+class TxQueue<0, RealTimeSize>
+{
+public:
+    inline bool reserve(MidiType, unsigned) { return true; }
+    inline bool extend(unsigned) { return true; }
+    inline bool pushRealTime(byte) { return true; }
+    inline void push(byte) {}
+    inline void commit() {}
+    inline unsigned available() const { return 0; }
+    inline bool isAccepted() const { return true; }
+    inline bool empty() const { return true; }
+
+    template<class Transport>
+    inline unsigned pump(Transport&, unsigned) { return 0; }
+};
+
+END_MIDI_NAMESPACE
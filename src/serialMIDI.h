@@ -27,6 +27,7 @@
  #pragma once
 
 #include "midi_Namespace.h"
+#include "midi_Transport.h"
 
 BEGIN_MIDI_NAMESPACE
 
@@ -52,6 +53,7 @@ public:
 
 public:
     static const bool thruActivated = true;
+    static const bool isByteStream = true;
     
     void begin()
 	{
@@ -78,6 +80,12 @@ public:
 		mSerial.write(value);
 	};
 
+	void write(const byte* data, size_t length)
+	{
+		// HardwareSerial::write(buffer, size) when available
+		TransportAdapter::write(mSerial, data, length);
+	};
+
 	void endTransmission()
 	{
 	};
@@ -92,6 +100,13 @@ public:
         return mSerial.available();
 	};
 
+#ifndef ARDUINO
+    int getFileDescriptor()
+    {
+        return mSerial.getFileDescriptor();
+    }
+#endif
+
 private:
     SerialPort& mSerial;
 };
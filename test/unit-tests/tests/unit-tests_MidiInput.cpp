@@ -988,4 +988,422 @@ TEST(MidiInput, strayUndefinedMultiByteParsing)
     EXPECT_EQ(midi.getData2(),      34);
 }
 
+// --
+
+struct EventBlockSettings : midi::DefaultSettings
+{
+    static const bool Use1ByteParsing = false;
+    static const unsigned EventBlockMaxSize = 3;
+};
+
+struct ManualPlatform
+{
+    static unsigned long now() { return sNow; }
+    static unsigned long sNow;
+};
+
+unsigned long ManualPlatform::sNow = 0;
+
+TEST(MidiInput, takeBlock)
+{
+    typedef midi::MidiInterface<Transport, EventBlockSettings, ManualPlatform> BlockMidiInterface;
+
+    SerialMock serial;
+    Transport transport(serial);
+    BlockMidiInterface midi(transport);
+
+    midi.begin(MIDI_CHANNEL_OMNI);
+    midi.turnThruOff();
+
+    EXPECT_EQ(midi.takeBlock(0, 48000).size, unsigned(0));
+
+    ManualPlatform::sNow = 995;
+    serial.mRxBuffer.write(0x90);
+    serial.mRxBuffer.write(42);
+    serial.mRxBuffer.write(127);
+    EXPECT_EQ(midi.read(), true);
+    ManualPlatform::sNow = 1002;
+    serial.mRxBuffer.write(0xf8);
+    EXPECT_EQ(midi.read(), true);
+    ManualPlatform::sNow = 1010;
+    serial.mRxBuffer.write(0xb3);
+    serial.mRxBuffer.write(7);
+    serial.mRxBuffer.write(100);
+    EXPECT_EQ(midi.read(), true);
+    serial.mRxBuffer.write(0x80); // Dropped, block is full
+    serial.mRxBuffer.write(42);
+    serial.mRxBuffer.write(0);
+    EXPECT_EQ(midi.read(), true);
+
+    const midi::EventBlock block = midi.takeBlock(1000, 48000);
+    ASSERT_EQ(block.size, unsigned(3));
+    EXPECT_EQ(block[0].offset,  0ul);
+    EXPECT_EQ(block[0].type,    midi::NoteOn);
+    EXPECT_EQ(block[0].channel, 1);
+    EXPECT_EQ(block[0].data1,   42);
+    EXPECT_EQ(block[0].data2,   127);
+    EXPECT_EQ(block[1].offset,  96ul);
+    EXPECT_EQ(block[1].type,    midi::Clock);
+    EXPECT_EQ(block[2].offset,  480ul);
+    EXPECT_EQ(block[2].type,    midi::ControlChange);
+    EXPECT_EQ(block[2].channel, 4);
+
+    // Events are taken only once
+    EXPECT_EQ(midi.takeBlock(1010, 48000).size, unsigned(0));
+
+    unsigned count = 0;
+    serial.mRxBuffer.write(0xfa);
+    EXPECT_EQ(midi.read(), true);
+    for (const midi::BlockEvent& event : midi.takeBlock(1010, 48000))
+    {
+        EXPECT_EQ(event.type, midi::Start);
+        count++;
+    }
+    EXPECT_EQ(count, unsigned(1));
+}
+
+struct MicrosBlockSettings : EventBlockSettings
+{
+    static const unsigned long PlatformTicksPerSecond = 1000000;
+};
+
+TEST(MidiInput, takeBlockTimeBase)
+{
+    typedef midi::MidiInterface<Transport, MicrosBlockSettings, ManualPlatform> BlockMidiInterface;
+
+    SerialMock serial;
+    Transport transport(serial);
+    BlockMidiInterface midi(transport);
+
+    midi.begin(MIDI_CHANNEL_OMNI);
+    midi.turnThruOff();
+
+    // Received just before the clock wrapped, 1.5 ms before the block start
+    ManualPlatform::sNow = ~0ul - 499;
+    serial.mRxBuffer.write(0xf8);
+    EXPECT_EQ(midi.read(), true);
+    // 1 second after the block start, wider than 32 bits once multiplied
+    ManualPlatform::sNow = 1000000 + 1000;
+    serial.mRxBuffer.write(0xfa);
+    EXPECT_EQ(midi.read(), true);
+    // 10 ms after the block start, after the wrap
+    ManualPlatform::sNow = 11000;
+    serial.mRxBuffer.write(0xfc);
+    EXPECT_EQ(midi.read(), true);
+
+    const midi::EventBlock block = midi.takeBlock(1000, 96000);
+    ASSERT_EQ(block.size, unsigned(3));
+    EXPECT_EQ(block[0].offset, 0ul);
+    EXPECT_EQ(block[1].offset, 96000ul);
+    EXPECT_EQ(block[2].offset, 960ul);
+}
+
+// --
+
+struct EventVisitor
+{
+    EventVisitor()
+        : mNoteOnCount(0)
+        , mLastNote(0)
+        , mPitchBend(0)
+        , mSysExSize(0)
+    {
+    }
+
+    void operator()(const midi::NoteOnEvent& inEvent)
+    {
+        mNoteOnCount++;
+        mLastNote = inEvent.note;
+    }
+    void operator()(const midi::PitchBendEvent& inEvent)
+    {
+        mPitchBend = inEvent.value;
+    }
+    void operator()(const midi::SystemExclusiveEvent& inEvent)
+    {
+        mSysExSize = inEvent.size;
+    }
+
+    unsigned mNoteOnCount;
+    byte mLastNote;
+    int mPitchBend;
+    unsigned mSysExSize;
+};
+
+TEST(MidiInput, visitor)
+{
+    SerialMock serial;
+    Transport transport(serial);
+    MidiInterface midi(transport);
+    EventVisitor visitor;
+
+    midi.begin(MIDI_CHANNEL_OMNI);
+    midi.turnThruOff();
+
+    static const unsigned rxSize = 14;
+    static const byte rxData[rxSize] = {
+        0x90, 42, 127, 0xe0, 0, 0x40, 0xb0, 1, 2, 0xf0, 1, 2, 0xf7, 0xf8
+    };
+    serial.mRxBuffer.write(rxData, rxSize);
+
+    EXPECT_EQ(midi.read(visitor), false);
+    EXPECT_EQ(midi.read(visitor), false);
+    EXPECT_EQ(midi.read(visitor), true);
+    EXPECT_EQ(visitor.mNoteOnCount, unsigned(1));
+    EXPECT_EQ(visitor.mLastNote, 42);
+    EXPECT_EQ(midi.read(visitor), false);
+    EXPECT_EQ(midi.read(visitor), false);
+    EXPECT_EQ(midi.read(visitor), true);
+    EXPECT_EQ(visitor.mPitchBend, 0);
+
+    // Events without an overload are ignored
+    EXPECT_EQ(midi.read(visitor), false);
+    EXPECT_EQ(midi.read(visitor), false);
+    EXPECT_EQ(midi.read(visitor), true);
+    EXPECT_EQ(midi.getType(), midi::ControlChange);
+
+    EXPECT_EQ(midi.read(visitor), false);
+    EXPECT_EQ(midi.read(visitor), false);
+    EXPECT_EQ(midi.read(visitor), false);
+    EXPECT_EQ(midi.read(visitor), true);
+    EXPECT_EQ(visitor.mSysExSize, unsigned(4));
+
+    // Lambdas, with a channel filter
+    unsigned clocks = 0;
+    auto lambda = [&clocks](const midi::ClockEvent&) { clocks++; };
+    EXPECT_EQ(midi.read(1, lambda), true);
+    EXPECT_EQ(clocks, unsigned(1));
+
+    // Integer arguments still select the channel overload
+    int channel = 4;
+    serial.mRxBuffer.write(0x93);
+    serial.mRxBuffer.write(12);
+    serial.mRxBuffer.write(34);
+    EXPECT_EQ(midi.read(channel), false);
+    EXPECT_EQ(midi.read(channel), false);
+    EXPECT_EQ(midi.read(channel), true);
+}
+
+// --
+
+typedef midi::SysExPool<64, 1> SharedSysExPool;
+
+struct PooledSettings : midi::DefaultSettings
+{
+    static const unsigned SysExMaxSize = 64;
+    typedef SharedSysExPool SysExPool;
+};
+
+unsigned sPoolErrors = 0;
+
+void handlePoolError(int8_t)
+{
+    sPoolErrors++;
+}
+
+TEST(MidiInput, sharedSysExPool)
+{
+    typedef midi::MidiInterface<Transport, PooledSettings> PooledMidiInterface;
+    typedef midi::MidiInterface<Transport, VariableSysExSettings<64> > OwnedMidiInterface;
+
+    EXPECT_LT(sizeof(PooledMidiInterface), sizeof(OwnedMidiInterface));
+
+    SerialMock serial1;
+    SerialMock serial2;
+    Transport transport1(serial1);
+    Transport transport2(serial2);
+    {
+        PooledMidiInterface midi1(transport1);
+        PooledMidiInterface midi2(transport2);
+        midi1.begin(MIDI_CHANNEL_OMNI);
+        midi2.begin(MIDI_CHANNEL_OMNI);
+        midi1.turnThruOff();
+        midi2.turnThruOff();
+        midi2.setHandleError(handlePoolError);
+        EXPECT_EQ(SharedSysExPool::available(), 1u);
+
+        static const byte sysex[4] = { 0xf0, 1, 2, 0xf7 };
+        serial1.mRxBuffer.write(sysex, 4);
+        serial2.mRxBuffer.write(sysex, 4);
+
+        for (unsigned i = 0; i < 3; ++i)
+            EXPECT_EQ(midi1.read(), false);
+        EXPECT_EQ(midi1.read(), true);
+        EXPECT_EQ(midi1.getType(), midi::SystemExclusive);
+        EXPECT_EQ(midi1.getSysExArrayLength(), 4u);
+        EXPECT_EQ(midi1.getSysExArray()[1], 1);
+        EXPECT_EQ(SharedSysExPool::available(), 0u);
+
+        // No block left: the second SysEx is dropped
+        EXPECT_EQ(midi2.read(), false);
+        EXPECT_EQ(sPoolErrors, 1u);
+        for (unsigned i = 0; i < 3; ++i)
+            EXPECT_EQ(midi2.read(), false);
+
+        // The next message gives the block back
+        serial1.mRxBuffer.write(0xf8);
+        EXPECT_EQ(midi1.read(), true);
+        EXPECT_EQ(SharedSysExPool::available(), 1u);
+
+        serial2.mRxBuffer.write(sysex, 4);
+        for (unsigned i = 0; i < 3; ++i)
+            EXPECT_EQ(midi2.read(), false);
+        EXPECT_EQ(midi2.read(), true);
+        EXPECT_EQ(midi2.getSysExArrayLength(), 4u);
+        EXPECT_EQ(SharedSysExPool::available(), 0u);
+    }
+    EXPECT_EQ(SharedSysExPool::available(), 1u);
+}
+
+TEST(MidiInput, sharedSysExPoolIdleInput)
+{
+    typedef midi::MidiInterface<Transport, PooledSettings> PooledMidiInterface;
+
+    SerialMock serial1;
+    SerialMock serial2;
+    Transport transport1(serial1);
+    Transport transport2(serial2);
+    PooledMidiInterface midi1(transport1);
+    PooledMidiInterface midi2(transport2);
+    midi1.begin(MIDI_CHANNEL_OMNI);
+    midi2.begin(MIDI_CHANNEL_OMNI);
+    midi1.turnThruOff();
+    midi2.turnThruOff();
+
+    // A real-time message in the middle of a SysEx keeps its block
+    static const byte sysex1[5] = { 0xf0, 1, 0xf8, 2, 0xf7 };
+    serial1.mRxBuffer.write(sysex1, 5);
+    for (unsigned i = 0; i < 2; ++i)
+        EXPECT_EQ(midi1.read(), false);
+    EXPECT_EQ(midi1.read(), true);
+    EXPECT_EQ(midi1.getType(), midi::Clock);
+    EXPECT_EQ(midi1.read(), false);
+    EXPECT_EQ(SharedSysExPool::available(), 0u);
+    EXPECT_EQ(midi1.read(), true);
+    EXPECT_EQ(midi1.getType(), midi::SystemExclusive);
+    EXPECT_EQ(midi1.getSysExArrayLength(), 4u);
+    EXPECT_EQ(midi1.getSysExArray()[2], 2);
+
+    // The first input goes quiet: its block is given back on the next read
+    EXPECT_EQ(midi1.read(), false);
+    EXPECT_EQ(SharedSysExPool::available(), 1u);
+
+    static const byte sysex2[4] = { 0xf0, 3, 4, 0xf7 };
+    serial2.mRxBuffer.write(sysex2, 4);
+    for (unsigned i = 0; i < 3; ++i)
+        EXPECT_EQ(midi2.read(), false);
+    EXPECT_EQ(midi2.read(), true);
+    EXPECT_EQ(midi2.getSysExArray()[1], 3);
+    EXPECT_EQ(SharedSysExPool::available(), 0u);
+    EXPECT_EQ(midi2.read(), false);
+    EXPECT_EQ(SharedSysExPool::available(), 1u);
+}
+
+TEST(MidiInput, sharedSysExPoolStrayEox)
+{
+    typedef midi::MidiInterface<Transport, PooledSettings> PooledMidiInterface;
+
+    SerialMock serial;
+    Transport transport(serial);
+    PooledMidiInterface midi(transport);
+    midi.begin(MIDI_CHANNEL_OMNI);
+    midi.turnThruOff();
+
+    static const byte sysex[4] = { 0xf0, 1, 2, 0xf7 };
+    serial.mRxBuffer.write(sysex, 4);
+    for (unsigned i = 0; i < 3; ++i)
+        EXPECT_EQ(midi.read(), false);
+    EXPECT_EQ(midi.read(), true);
+    EXPECT_EQ(midi.getType(), midi::SystemExclusive);
+
+    // The NoteOn gives the block back, the EOX in the middle of it is an error
+    static const byte noteOn[3] = { 0x90, 60, 0xf7 };
+    serial.mRxBuffer.write(noteOn, 3);
+    EXPECT_EQ(SharedSysExPool::available(), 0u);
+    EXPECT_EQ(midi.read(), false);
+    EXPECT_EQ(SharedSysExPool::available(), 1u);
+    EXPECT_EQ(midi.read(), false);
+    EXPECT_EQ(midi.read(), false);
+    EXPECT_EQ(midi.getType(), midi::SystemExclusive);
+
+    // Parsing goes on with the next message
+    static const byte noteOff[3] = { 0x80, 60, 64 };
+    serial.mRxBuffer.write(noteOff, 3);
+    EXPECT_EQ(midi.read(), false);
+    EXPECT_EQ(midi.read(), false);
+    EXPECT_EQ(midi.read(), true);
+    EXPECT_EQ(midi.getType(), midi::NoteOff);
+    EXPECT_EQ(midi.getData1(), 60);
+}
+
+// -----------------------------------------------------------------------------
+
+struct AllFeaturesSettings : midi::DefaultSettings
+{
+    static const bool UseRunningStatus = true;
+    static const bool UseSenderActiveSensing = true;
+    static const bool UseReceiverActiveSensing = true;
+    static const unsigned EventBlockMaxSize = 4;
+    static const bool UseHandlerProfiler = true;
+};
+
+TEST(MidiInput, disabledFeaturesTakeNoSpace)
+{
+    typedef midi::DefaultPlatform Platform;
+    EXPECT_TRUE((std::is_empty<midi::SenderActiveSensingState<Platform, false>>::value));
+    EXPECT_TRUE((std::is_empty<midi::ReceiverActiveSensingState<Platform, false>>::value));
+    EXPECT_TRUE((std::is_empty<midi::RunningStatusTxState<false>>::value));
+    EXPECT_TRUE((std::is_empty<midi::EventBlockQueue<0>>::value));
+    EXPECT_TRUE((std::is_empty<midi::HandlerProfiler<Platform, false>>::value));
+    EXPECT_TRUE((std::is_empty<midi::OutputCache<false>>::value));
+    EXPECT_TRUE((std::is_empty<midi::PacedSysExState<Platform, false>>::value));
+    EXPECT_TRUE((std::is_empty<midi::Scheduler<0>>::value));
+
+    typedef midi::MidiInterface<Transport, AllFeaturesSettings> FullMidiInterface;
+    const size_t featuresSize = sizeof(midi::SenderActiveSensingState<Platform, true>)
+                              + sizeof(midi::ReceiverActiveSensingState<Platform, true>)
+                              + sizeof(midi::EventBlockQueue<4>)
+                              + sizeof(midi::HandlerProfiler<Platform, true>);
+    // The running status byte may fit in padding, it is not counted.
+    EXPECT_GE(sizeof(FullMidiInterface), sizeof(MidiInterface) + featuresSize);
+}
+
+TEST(MidiInput, inputCoreIsSharedBetweenTransports)
+{
+    typedef test_mocks::SerialMock<64> OtherSerialMock;
+    typedef midi::MidiInterface<midi::SerialMIDI<OtherSerialMock>> OtherMidiInterface;
+    typedef midi::InputCore<midi::DefaultSettings,
+                            midi::DefaultPlatform,
+                            midi::CallbackHandler<midi::DefaultSettings>> Core;
+
+    EXPECT_TRUE((std::is_base_of<Core, MidiInterface>::value));
+    EXPECT_TRUE((std::is_base_of<Core, OtherMidiInterface>::value));
+
+    // Both interfaces parse and dispatch through the same core code
+    SerialMock serial1;
+    OtherSerialMock serial2;
+    Transport transport1(serial1);
+    midi::SerialMIDI<OtherSerialMock> transport2(serial2);
+    MidiInterface midi1(transport1);
+    OtherMidiInterface midi2(transport2);
+    midi1.begin(MIDI_CHANNEL_OMNI);
+    midi2.begin(MIDI_CHANNEL_OMNI);
+    midi1.turnThruOff();
+    midi2.turnThruOff();
+
+    static const byte noteOn[] = { 0x92, 12, 34 };
+    serial1.mRxBuffer.write(noteOn, 3);
+    serial2.mRxBuffer.write(noteOn, 3);
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        EXPECT_EQ(midi1.read(), false);
+        EXPECT_EQ(midi2.read(), false);
+    }
+    EXPECT_EQ(midi1.read(), true);
+    EXPECT_EQ(midi2.read(), true);
+    EXPECT_EQ(midi1.getType(), midi2.getType());
+    EXPECT_EQ(midi1.getChannel(), 3);
+    EXPECT_EQ(midi2.getData2(), 34);
+}
+
 END_UNNAMED_NAMESPACE
@@ -0,0 +1,113 @@
+#include "unit-tests.h"
+#include <src/MIDI.h>
+#include <test/mocks/test-mocks_SerialMock.h>
+#include <thread>
+
+BEGIN_MIDI_NAMESPACE
+
+END_MIDI_NAMESPACE
+
+// -----------------------------------------------------------------------------
+
+BEGIN_UNNAMED_NAMESPACE
+
+using namespace testing;
+USING_NAMESPACE_UNIT_TESTS
+
+typedef test_mocks::SerialMock<32> SerialMock;
+typedef midi::SerialMIDI<SerialMock> Transport;
+typedef midi::AtomicCallbackHandler<midi::DefaultSettings> Handler;
+typedef midi::MidiInterface<Transport,
+                            midi::DefaultSettings,
+                            midi::DefaultPlatform,
+                            Handler> MidiInterface;
+typedef Handler::MidiMessage MidiMessage;
+
+std::atomic<unsigned> sNoteOnCount(0);
+
+void handleNoteOn(byte, byte, byte)
+{
+    sNoteOnCount++;
+}
+
+TEST(MidiInputAtomicCallbacks, update)
+{
+    SerialMock serial;
+    Transport transport(serial);
+    MidiInterface midi(transport);
+
+    sNoteOnCount = 0;
+    midi.begin(MIDI_CHANNEL_OMNI);
+    midi.turnThruOff();
+    midi.getHandler()->update([](Handler::CallbackSet& callbacks)
+    {
+        callbacks.setHandleNoteOn(handleNoteOn);
+    });
+
+    static const unsigned rxSize = 6;
+    static const byte rxData[rxSize] = { 0x90, 12, 34, 0x90, 56, 78 };
+    serial.mRxBuffer.write(rxData, rxSize);
+
+    EXPECT_EQ(midi.read(), false);
+    EXPECT_EQ(midi.read(), false);
+    EXPECT_EQ(midi.read(), true);
+    EXPECT_EQ(sNoteOnCount, 1u);
+
+    std::unique_ptr<Handler::CallbackSet> callbacks = midi.getHandler()->copy();
+    callbacks->disconnectCallbackFromType(midi::NoteOn);
+    midi.getHandler()->publish(std::move(callbacks));
+    EXPECT_EQ(midi.getHandler()->reclaim(), 0u);
+
+    EXPECT_EQ(midi.read(), false);
+    EXPECT_EQ(midi.read(), false);
+    EXPECT_EQ(midi.read(), true);
+    EXPECT_EQ(sNoteOnCount, 1u);
+}
+
+// Each published set binds a pair of callbacks counting in the same slot:
+// a half-updated set would make the counts of a slot differ.
+std::atomic<unsigned> sCounts[2][2];
+
+void countMessage0(const MidiMessage&)  { sCounts[0][0]++; }
+void countNoteOn0(byte, byte, byte)     { sCounts[0][1]++; }
+void countMessage1(const MidiMessage&)  { sCounts[1][0]++; }
+void countNoteOn1(byte, byte, byte)     { sCounts[1][1]++; }
+
+TEST(MidiInputAtomicCallbacks, concurrentUpdates)
+{
+    Handler handler;
+    MidiMessage noteOn;
+    noteOn.type = midi::NoteOn;
+    noteOn.channel = 1;
+
+    for (unsigned i = 0; i < 4; ++i)
+        sCounts[i / 2][i % 2] = 0;
+
+    static const unsigned numMessages = 100000;
+    std::atomic<bool> done(false);
+    std::thread reader([&]()
+    {
+        for (unsigned i = 0; i < numMessages; ++i)
+            handler.onMessage(noteOn);
+        done = true;
+    });
+
+    unsigned updates = 0;
+    while (!done)
+    {
+        const bool even = (updates++ & 1) == 0;
+        handler.update([even](Handler::CallbackSet& callbacks)
+        {
+            callbacks.setHandleMessage(even ? countMessage0 : countMessage1);
+            callbacks.setHandleNoteOn(even ? countNoteOn0 : countNoteOn1);
+        });
+    }
+    reader.join();
+
+    EXPECT_EQ(sCounts[0][0], sCounts[0][1]);
+    EXPECT_EQ(sCounts[1][0], sCounts[1][1]);
+    EXPECT_LE(sCounts[0][0] + sCounts[1][0], numMessages);
+    EXPECT_EQ(handler.reclaim(), 0u);
+}
+
+END_UNNAMED_NAMESPACE
@@ -591,4 +591,221 @@ TEST_F(MidiInputCallbacks, realTime)
     }
 }
 
+// --
+
+struct NoteCounter
+{
+    unsigned mCount;
+    byte mLastNote;
+};
+
+void handleNoteOnWithContext(void* inContext, const MidiInterface::MidiMessage& inMessage)
+{
+    NoteCounter* counter = static_cast<NoteCounter*>(inContext);
+    counter->mCount++;
+    counter->mLastNote = inMessage.data1;
+}
+
+TEST_F(MidiInputCallbacks, context)
+{
+    SerialMock otherSerial;
+    Transport otherTransport(otherSerial);
+    MidiInterface otherMidi(otherTransport);
+
+    NoteCounter counter      = { 0, 0 };
+    NoteCounter otherCounter = { 0, 0 };
+    mMidi.setHandle(midi::NoteOn, handleNoteOnWithContext, &counter);
+    otherMidi.setHandle(midi::NoteOn, handleNoteOnWithContext, &otherCounter);
+    mMidi.begin(MIDI_CHANNEL_OMNI);
+    otherMidi.begin(MIDI_CHANNEL_OMNI);
+    mMidi.turnThruOff();
+    otherMidi.turnThruOff();
+
+    static const unsigned rxSize = 3;
+    static const byte rxData[rxSize] = { 0x90, 12, 34 };
+    static const byte otherRxData[rxSize] = { 0x90, 56, 78 };
+    mSerial.mRxBuffer.write(rxData, rxSize);
+    otherSerial.mRxBuffer.write(otherRxData, rxSize);
+
+    EXPECT_EQ(mMidi.read(), false);
+    EXPECT_EQ(mMidi.read(), false);
+    EXPECT_EQ(mMidi.read(), true);
+    EXPECT_EQ(counter.mCount,       unsigned(1));
+    EXPECT_EQ(counter.mLastNote,    12);
+    EXPECT_EQ(otherCounter.mCount,  unsigned(0));
+
+    EXPECT_EQ(otherMidi.read(), false);
+    EXPECT_EQ(otherMidi.read(), false);
+    EXPECT_EQ(otherMidi.read(), true);
+    EXPECT_EQ(counter.mCount,           unsigned(1));
+    EXPECT_EQ(otherCounter.mCount,      unsigned(1));
+    EXPECT_EQ(otherCounter.mLastNote,   56);
+}
+
+// --
+
+unsigned sDisconnectedCalls = 0;
+
+void handleDisconnected(byte, byte, byte)
+{
+    sDisconnectedCalls++;
+}
+
+TEST_F(MidiInputCallbacks, disconnect)
+{
+    sDisconnectedCalls = 0;
+    mMidi.setHandleNoteOn(handleDisconnected);
+    mMidi.disconnectCallbackFromType(midi::NoteOn);
+    mMidi.disconnectCallbackFromType(midi::InvalidType); // Ignored
+    mMidi.begin(MIDI_CHANNEL_OMNI);
+    mMidi.turnThruOff();
+
+    static const unsigned rxSize = 3;
+    static const byte rxData[rxSize] = { 0x90, 12, 34 };
+    mSerial.mRxBuffer.write(rxData, rxSize);
+
+    EXPECT_EQ(mMidi.read(), false);
+    EXPECT_EQ(mMidi.read(), false);
+    EXPECT_EQ(mMidi.read(), true);
+    EXPECT_EQ(sDisconnectedCalls, unsigned(0));
+}
+
+// --
+
+struct ChannelRoutingSettings : midi::DefaultSettings
+{
+    static const unsigned MaxChannelCallbacks = 2;
+};
+
+unsigned sOmniNoteOnCalls = 0;
+unsigned sDrumsNoteOnCalls = 0;
+unsigned sBassNoteOnCalls = 0;
+
+void handleOmniNoteOn(byte, byte, byte)
+{
+    sOmniNoteOnCalls++;
+}
+void handleDrumsNoteOn(byte inChannel, byte, byte)
+{
+    EXPECT_EQ(inChannel, 10);
+    sDrumsNoteOnCalls++;
+}
+void handleBassNoteOn(byte inChannel, byte, byte)
+{
+    EXPECT_EQ(inChannel, 2);
+    sBassNoteOnCalls++;
+}
+
+TEST(MidiInputCallbacksRouting, channelRouting)
+{
+    typedef midi::MidiInterface<Transport, ChannelRoutingSettings> RoutingMidiInterface;
+    SerialMock serial;
+    Transport transport(serial);
+    RoutingMidiInterface routingMidi(transport);
+
+    sOmniNoteOnCalls  = 0;
+    sDrumsNoteOnCalls = 0;
+    sBassNoteOnCalls  = 0;
+    routingMidi.setHandleNoteOn(handleOmniNoteOn);
+    routingMidi.setHandleNoteOn(10, handleDrumsNoteOn);
+    routingMidi.setHandleNoteOn(2, handleBassNoteOn);
+    routingMidi.setHandleNoteOn(3, handleBassNoteOn); // Pool is full, ignored
+    EXPECT_TRUE(routingMidi.hasChannelHandle(midi::NoteOn, 10));
+    EXPECT_TRUE(routingMidi.hasChannelHandle(midi::NoteOn, 2));
+    EXPECT_FALSE(routingMidi.hasChannelHandle(midi::NoteOn, 3));
+    EXPECT_FALSE(routingMidi.hasChannelHandle(midi::NoteOff, 10));
+    EXPECT_FALSE(routingMidi.hasChannelHandle(midi::Clock, 10));
+    routingMidi.begin(MIDI_CHANNEL_OMNI);
+    routingMidi.turnThruOff();
+
+    static const unsigned rxSize = 12;
+    static const byte rxData[rxSize] = {
+        0x99, 36, 127,
+        0x91, 12, 34,
+        0x92, 12, 34,
+        0x93, 12, 34,
+    };
+    serial.mRxBuffer.write(rxData, rxSize);
+    for (unsigned i = 0; i < rxSize; ++i)
+        routingMidi.read();
+
+    EXPECT_EQ(sDrumsNoteOnCalls,    unsigned(1));
+    EXPECT_EQ(sBassNoteOnCalls,     unsigned(1));
+    EXPECT_EQ(sOmniNoteOnCalls,     unsigned(2));
+
+    // Disconnecting falls back to the callback for all channels
+    routingMidi.disconnectCallbackFromType(midi::NoteOn, 10);
+    routingMidi.setHandleNoteOn(3, handleBassNoteOn); // Now fits, but wrong channel
+    EXPECT_TRUE(routingMidi.hasChannelHandle(midi::NoteOn, 3));
+    routingMidi.disconnectCallbackFromType(midi::NoteOn, 3);
+    EXPECT_FALSE(routingMidi.hasChannelHandle(midi::NoteOn, 3));
+    serial.mRxBuffer.write(rxData, 3);
+    for (unsigned i = 0; i < 3; ++i)
+        routingMidi.read();
+
+    EXPECT_EQ(sDrumsNoteOnCalls,    unsigned(1));
+    EXPECT_EQ(sOmniNoteOnCalls,     unsigned(3));
+}
+
+// --
+
+struct ProfilerSettings : midi::DefaultSettings
+{
+    static const bool UseHandlerProfiler = true;
+};
+
+struct ProfilerPlatform
+{
+    static unsigned long now() { return sNow; }
+    static unsigned long sNow;
+};
+
+unsigned long ProfilerPlatform::sNow = 0;
+unsigned long sHandlerDuration = 0;
+
+void handleSlowNoteOn(byte, byte, byte)
+{
+    ProfilerPlatform::sNow += sHandlerDuration;
+}
+
+TEST(MidiInputCallbacksProfiler, handlerStats)
+{
+    typedef midi::MidiInterface<Transport, ProfilerSettings, ProfilerPlatform> ProfiledMidiInterface;
+
+    SerialMock serial;
+    Transport transport(serial);
+    ProfiledMidiInterface profiledMidi(transport);
+
+    profiledMidi.begin(MIDI_CHANNEL_OMNI);
+    profiledMidi.turnThruOff();
+    profiledMidi.setHandleNoteOn(handleSlowNoteOn);
+
+    static const unsigned durations[3] = { 100, 20, 60 };
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        sHandlerDuration = durations[i];
+        serial.mRxBuffer.write(0x90);
+        serial.mRxBuffer.write(42);
+        serial.mRxBuffer.write(127);
+        EXPECT_EQ(profiledMidi.read(), false);
+        EXPECT_EQ(profiledMidi.read(), false);
+        EXPECT_EQ(profiledMidi.read(), true);
+    }
+
+    const midi::HandlerStats stats = profiledMidi.getHandlerStats(midi::NoteOn);
+    EXPECT_EQ(stats.count,   3ul);
+    EXPECT_EQ(stats.total,   180ul);
+    EXPECT_EQ(stats.minimum, 20ul);
+    EXPECT_EQ(stats.maximum, 100ul);
+    EXPECT_EQ(stats.average, 86ul); // 100, then 90, then 86.25
+    EXPECT_EQ(profiledMidi.getHandlerStats(midi::NoteOff).count, 0ul);
+
+    profiledMidi.resetHandlerStats();
+    EXPECT_EQ(profiledMidi.getHandlerStats(midi::NoteOn).count, 0ul);
+
+    // Disabled by default
+    typedef midi::MidiInterface<Transport, midi::DefaultSettings, ProfilerPlatform> DefaultMidiInterface;
+    EXPECT_LT(sizeof(DefaultMidiInterface), sizeof(ProfiledMidiInterface));
+}
+
 END_UNNAMED_NAMESPACE
@@ -0,0 +1,146 @@
+#include "unit-tests.h"
+#include <src/MIDI.h>
+
+#ifdef MIDI_HAS_COROUTINES
+
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+// -----------------------------------------------------------------------------
+
+BEGIN_UNNAMED_NAMESPACE
+
+using namespace testing;
+USING_NAMESPACE_UNIT_TESTS
+
+// Serial port reading from a pipe, so that it can be polled.
+struct PipeSerial
+{
+    PipeSerial()
+    {
+        EXPECT_EQ(pipe(mFds), 0);
+    }
+    ~PipeSerial()
+    {
+        close(mFds[0]);
+        hangUp();
+    }
+
+    // Close the writing end, as a disconnected device would.
+    void hangUp()
+    {
+        if (mFds[1] >= 0)
+            close(mFds[1]);
+        mFds[1] = -1;
+    }
+
+    void begin(unsigned long) {}
+    void write(byte inData)
+    {
+        EXPECT_EQ(::write(mFds[1], &inData, 1), 1);
+    }
+    void send(const byte* inData, unsigned inSize)
+    {
+        EXPECT_EQ(::write(mFds[1], inData, inSize), ssize_t(inSize));
+    }
+    byte read()
+    {
+        byte data = 0;
+        EXPECT_EQ(::read(mFds[0], &data, 1), 1);
+        return data;
+    }
+    unsigned available()
+    {
+        int size = 0;
+        ioctl(mFds[0], FIONREAD, &size);
+        return unsigned(size);
+    }
+    int getFileDescriptor()
+    {
+        return mFds[0];
+    }
+
+    int mFds[2];
+};
+
+typedef midi::SerialMIDI<PipeSerial> Transport;
+typedef midi::MidiInterface<Transport> MidiInterface;
+
+midi::DetachedTask receive(MidiInterface& inMidi,
+                           midi::PollExecutor& inExecutor,
+                           std::vector<MidiInterface::MidiMessage>& outMessages,
+                           unsigned inCount)
+{
+    for (unsigned i = 0; i < inCount; ++i)
+        outMessages.push_back(co_await inMidi.next(inExecutor));
+}
+
+TEST(MidiInputCoroutine, next)
+{
+    PipeSerial serial;
+    Transport transport(serial);
+    MidiInterface midi(transport);
+    midi::PollExecutor executor;
+    std::vector<MidiInterface::MidiMessage> messages;
+
+    midi.begin(MIDI_CHANNEL_OMNI);
+    midi.turnThruOff();
+
+    receive(midi, executor, messages, 2);
+    EXPECT_EQ(messages.size(), 0u);
+    EXPECT_FALSE(executor.empty());
+    EXPECT_EQ(executor.runOnce(0), 0u);
+
+    // Incomplete message: keeps waiting
+    static const byte part1[] = { 0x9b, 12 };
+    serial.send(part1, 2);
+    EXPECT_EQ(executor.runOnce(0), 0u);
+    EXPECT_EQ(messages.size(), 0u);
+
+    static const byte part2[] = { 34, 0xb0, 1, 2 };
+    serial.send(part2, 4);
+    EXPECT_EQ(executor.runOnce(0), 1u);
+    ASSERT_EQ(messages.size(), 2u);
+    EXPECT_EQ(messages[0].type,    midi::NoteOn);
+    EXPECT_EQ(messages[0].channel, 12);
+    EXPECT_EQ(messages[0].data1,   12);
+    EXPECT_EQ(messages[0].data2,   34);
+
+    // The second message was already available: no suspension
+    EXPECT_EQ(messages[1].type,    midi::ControlChange);
+    EXPECT_EQ(messages[1].data2,   2);
+    EXPECT_TRUE(executor.empty());
+}
+
+TEST(MidiInputCoroutine, hangUp)
+{
+    PipeSerial serial;
+    Transport transport(serial);
+    MidiInterface midi(transport);
+    midi::PollExecutor executor;
+    std::vector<MidiInterface::MidiMessage> messages;
+
+    midi.begin(MIDI_CHANNEL_OMNI);
+    midi.turnThruOff();
+
+    receive(midi, executor, messages, 1);
+    EXPECT_EQ(executor.runOnce(0), 0u);
+
+    // The pending bytes are read, then the waiter is closed.
+    static const byte part[] = { 0x9b, 12 };
+    serial.send(part, 2);
+    serial.hangUp();
+    EXPECT_EQ(executor.runOnce(0), 1u);
+    ASSERT_EQ(messages.size(), 1u);
+    EXPECT_FALSE(messages[0].valid);
+    EXPECT_EQ(messages[0].type, midi::InvalidType);
+    EXPECT_EQ(serial.available(), 0u);
+    EXPECT_TRUE(executor.empty());
+
+    // run() returns rather than spinning on the closed descriptor.
+    executor.run();
+}
+
+END_UNNAMED_NAMESPACE
+
+#endif // MIDI_HAS_COROUTINES
@@ -0,0 +1,146 @@
+#include "unit-tests.h"
+#include "unit-tests_Settings.h"
+#include <src/MIDI.h>
+#include <test/mocks/test-mocks_SerialMock.h>
+
+BEGIN_MIDI_NAMESPACE
+
+END_MIDI_NAMESPACE
+
+// -----------------------------------------------------------------------------
+
+BEGIN_UNNAMED_NAMESPACE
+
+using namespace testing;
+USING_NAMESPACE_UNIT_TESTS
+
+typedef test_mocks::SerialMock<32> SerialMock;
+typedef midi::SerialMIDI<SerialMock> Transport;
+
+// --
+
+struct StaticHandler : public midi::EmptyHandler
+{
+    static void onNoteOn(byte inChannel, byte inNote, byte inVelocity)
+    {
+        sChannel  = inChannel;
+        sNote     = inNote;
+        sVelocity = inVelocity;
+        sCount++;
+    }
+
+    static byte sChannel;
+    static byte sNote;
+    static byte sVelocity;
+    static unsigned sCount;
+};
+
+byte StaticHandler::sChannel  = 0;
+byte StaticHandler::sNote     = 0;
+byte StaticHandler::sVelocity = 0;
+unsigned StaticHandler::sCount = 0;
+
+TEST(MidiInputHandler, staticHooks)
+{
+    typedef midi::MidiInterface<Transport,
+                                midi::DefaultSettings,
+                                midi::DefaultPlatform,
+                                StaticHandler> MidiInterface;
+    SerialMock serial;
+    Transport transport(serial);
+    MidiInterface midi(transport);
+
+    StaticHandler::sCount = 0;
+    midi.begin(MIDI_CHANNEL_OMNI);
+    midi.turnThruOff();
+
+    static const unsigned rxSize = 6;
+    static const byte rxData[rxSize] = { 0x9b, 12, 34, 0xb0, 1, 2 };
+    serial.mRxBuffer.write(rxData, rxSize);
+
+    EXPECT_EQ(midi.read(), false);
+    EXPECT_EQ(midi.read(), false);
+    EXPECT_EQ(midi.read(), true);
+    EXPECT_EQ(StaticHandler::sCount,    unsigned(1));
+    EXPECT_EQ(StaticHandler::sChannel,  12);
+    EXPECT_EQ(StaticHandler::sNote,     12);
+    EXPECT_EQ(StaticHandler::sVelocity, 34);
+
+    // Hooks that are not hidden are no-ops
+    EXPECT_EQ(midi.read(), false);
+    EXPECT_EQ(midi.read(), false);
+    EXPECT_EQ(midi.read(), true);
+    EXPECT_EQ(midi.getType(), midi::ControlChange);
+    EXPECT_EQ(StaticHandler::sCount, unsigned(1));
+}
+
+// --
+
+struct MemberHandler : public midi::EmptyHandler
+{
+    MemberHandler()
+        : mLastControlValue(0)
+        , mPitchBend(0)
+        , mLastError(0)
+    {
+    }
+
+    void onControlChange(byte, byte, byte inValue)
+    {
+        mLastControlValue = inValue;
+    }
+    void onPitchBend(byte, int inValue)
+    {
+        mPitchBend = inValue;
+    }
+    void onError(int8_t inError)
+    {
+        mLastError = inError;
+    }
+
+    byte mLastControlValue;
+    int mPitchBend;
+    int8_t mLastError;
+};
+
+TEST(MidiInputHandler, memberHooks)
+{
+    typedef midi::MidiInterface<Transport,
+                                midi::DefaultSettings,
+                                midi::DefaultPlatform,
+                                MemberHandler> MidiInterface;
+    SerialMock serial;
+    Transport transport(serial);
+    MidiInterface midi(transport);
+
+    midi.begin(MIDI_CHANNEL_OMNI);
+    midi.turnThruOff();
+
+    static const unsigned rxSize = 7;
+    static const byte rxData[rxSize] = { 0xb0, 1, 42, 0xe0, 0, 0, 0xf4 };
+    serial.mRxBuffer.write(rxData, rxSize);
+
+    EXPECT_EQ(midi.read(), false);
+    EXPECT_EQ(midi.read(), false);
+    EXPECT_EQ(midi.read(), true);
+    EXPECT_EQ(midi.getHandler()->mLastControlValue, 42);
+    EXPECT_EQ(midi.read(), false);
+    EXPECT_EQ(midi.read(), false);
+    EXPECT_EQ(midi.read(), true);
+    EXPECT_EQ(midi.getHandler()->mPitchBend, MIDI_PITCHBEND_MIN);
+    EXPECT_EQ(midi.read(), false);
+    EXPECT_EQ(midi.getHandler()->mLastError, 1 << midi::ErrorParse);
+}
+
+TEST(MidiInputHandler, staticHandlerHasNoCallbackStorage)
+{
+    typedef midi::MidiInterface<Transport> CallbackMidiInterface;
+    typedef midi::MidiInterface<Transport,
+                                midi::DefaultSettings,
+                                midi::DefaultPlatform,
+                                StaticHandler> StaticMidiInterface;
+
+    EXPECT_LT(sizeof(StaticMidiInterface), sizeof(CallbackMidiInterface));
+}
+
+END_UNNAMED_NAMESPACE
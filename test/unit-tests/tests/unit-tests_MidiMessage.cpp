@@ -1,13 +1,14 @@
 #include "unit-tests.h"
 #include <src/midi_Message.h>
+#include <src/midi_PackedMessage.h>
 
 BEGIN_MIDI_NAMESPACE
 
 // Declare references:
 // http://stackoverflow.com/questions/4891067/weird-undefined-symbols-of-static-constants-inside-a-struct-class
 
-template<unsigned Size>
-const unsigned Message<Size>::sSysExMaxSize;
+template<unsigned Size, class Pool>
+const unsigned Message<Size, Pool>::sSysExMaxSize;
 
 END_MIDI_NAMESPACE
 
@@ -80,4 +81,96 @@ TEST(MidiMessage, getSysExSize)
     }
 }
 
+TEST(MidiMessage, copyOnlySysExPayload)
+{
+    typedef midi::Message<32> Message;
+    Message source;
+    source.type = midi::SystemExclusive;
+    source.valid = true;
+    setSysExSize(source, 4);
+    const byte payload[4] = { 0xf0, 12, 42, 0xf7 };
+    memcpy(source.sysexArray, payload, 4);
+    source.sysexArray[10] = 0xaa;
+
+    const Message copy(source);
+    EXPECT_EQ(copy.getSysExSize(), 4u);
+    EXPECT_EQ(memcmp(copy.sysexArray, payload, 4), 0);
+
+    Message target;
+    target.sysexArray[10] = 0x55;
+    target = source;
+    EXPECT_EQ(target.type, midi::SystemExclusive);
+    EXPECT_EQ(memcmp(target.sysexArray, payload, 4), 0);
+    EXPECT_EQ(target.sysexArray[10], 0x55); // Beyond the payload: not copied
+}
+
+TEST(MidiMessage, view)
+{
+    typedef midi::Message<32> Message;
+    Message message;
+    message.type    = midi::ControlChange;
+    message.channel = 3;
+    message.data1   = 7;
+    message.data2   = 100;
+
+    midi::MessageView view = message;
+    EXPECT_EQ(view.type,       midi::ControlChange);
+    EXPECT_EQ(view.channel,    3);
+    EXPECT_EQ(view.data1,      7);
+    EXPECT_EQ(view.data2,      100);
+    EXPECT_EQ(view.sysexArray, nullptr);
+    EXPECT_EQ(view.sysexSize,  0u);
+    EXPECT_TRUE(view.isChannelMessage());
+
+    message.type = midi::SystemExclusive;
+    setSysExSize(message, 3);
+    view = message;
+    EXPECT_EQ(view.sysexArray, message.sysexArray);
+    EXPECT_EQ(view.sysexSize,  3u);
+    EXPECT_LT(sizeof(midi::MessageView), sizeof(Message));
+}
+
+TEST(MidiMessage, packed)
+{
+    constexpr midi::PackedMessage noteOn(midi::NoteOn, 3, 60, 100, 2);
+    static_assert(noteOn.word == 0x02643c92, "Packed at compile time");
+    static_assert(noteOn.type() == midi::NoteOn, "Unpacked at compile time");
+    static_assert(noteOn.channel() == 3, "Unpacked at compile time");
+    static_assert(sizeof(midi::PackedMessage) == 4, "Single 32-bit word");
+
+    typedef midi::Message<32> Message;
+    Message message;
+    message.type    = midi::PitchBend;
+    message.channel = 16;
+    message.data1   = 0x12;
+    message.data2   = 0x34;
+    message.length  = 3;
+    message.valid   = true;
+
+    const midi::PackedMessage packed = midi::pack(message, 7);
+    EXPECT_TRUE(packed.valid());
+    EXPECT_EQ(packed.status(),  0xef);
+    EXPECT_EQ(packed.port(),    7);
+
+    Message unpacked;
+    midi::unpack(packed, unpacked);
+    EXPECT_EQ(unpacked.type,    midi::PitchBend);
+    EXPECT_EQ(unpacked.channel, 16);
+    EXPECT_EQ(unpacked.data1,   0x12);
+    EXPECT_EQ(unpacked.data2,   0x34);
+    EXPECT_EQ(unpacked.length,  3u);
+    EXPECT_TRUE(unpacked.valid);
+
+    // System messages
+    EXPECT_EQ(midi::PackedMessage(midi::Clock, 0, 0, 0).length(), 1u);
+    EXPECT_EQ(midi::PackedMessage(midi::Clock, 0, 0, 0).channel(), 0);
+    EXPECT_EQ(midi::PackedMessage(midi::SongSelect, 0, 5, 0).length(), 2u);
+    EXPECT_EQ(midi::PackedMessage(midi::SongPosition, 0, 5, 6).length(), 3u);
+    EXPECT_EQ(midi::PackedMessage(midi::ProgramChange, 1, 5, 0).length(), 2u);
+
+    // SysEx cannot be packed
+    message.type = midi::SystemExclusive;
+    EXPECT_FALSE(midi::pack(message).valid());
+}
+
 END_UNNAMED_NAMESPACE
@@ -125,6 +125,61 @@ TEST(MidiOutput, sendGenericBreakingRunningStatus)
     EXPECT_THAT(buffer, ElementsAreArray({0x9b, 47, 42, 0x8b, 47, 42}));
 }
 
+struct EncoderSettings : midi::DefaultSettings
+{
+    static const bool UseRunningStatus = true;
+    static const bool SendNoteOffAsNullVelocityNoteOn = true;
+    static const unsigned RunningStatusRefreshCount = 3;
+    static const uint16_t RunningStatusRefreshPeriod = 100;
+};
+
+struct ManualPlatform
+{
+    static unsigned long now() { return sNow; }
+    static unsigned long sNow;
+};
+
+unsigned long ManualPlatform::sNow = 0;
+
+TEST(MidiOutput, sendEncoded)
+{
+    typedef midi::MidiInterface<Transport, EncoderSettings, ManualPlatform> EncoderMidiInterface;
+
+    SerialMock serial;
+    Transport transport(serial);
+    EncoderMidiInterface midi((Transport&)transport);
+
+    Buffer buffer;
+
+    midi.begin();
+
+    // NoteOff is sent as NoteOn, real-time messages keep the running status
+    midi.sendNoteOn(47, 42, 12);
+    midi.sendNoteOff(47, 64, 12);
+    midi.sendClock();
+    midi.sendNoteOn(48, 42, 12);
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 8);
+    buffer.resize(8);
+    serial.mTxBuffer.read(&buffer[0], 8);
+    EXPECT_THAT(buffer, ElementsAreArray({0x9b, 47, 42, 47, 0, 0xf8, 48, 42}));
+
+    // Status is sent again after 3 messages without it
+    midi.sendNoteOff(48, 0, 12);
+    midi.sendNoteOn(49, 42, 12);
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 5);
+    buffer.resize(5);
+    serial.mTxBuffer.read(&buffer[0], 5);
+    EXPECT_THAT(buffer, ElementsAreArray({48, 0, 0x9b, 49, 42}));
+
+    // Status is sent again after 100ms
+    ManualPlatform::sNow += 100;
+    midi.sendNoteOff(49, 0, 12);
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 3);
+    buffer.resize(3);
+    serial.mTxBuffer.read(&buffer[0], 3);
+    EXPECT_THAT(buffer, ElementsAreArray({0x9b, 49, 0}));
+}
+
 TEST(MidiOutput, sendGenericRealTimeShortcut)
 {
     SerialMock serial;
@@ -412,6 +467,48 @@ TEST(MidiOutput, sendSysEx)
     }
 }
 
+TEST(MidiOutput, sendEncodedSysEx)
+{
+    SerialMock serial;
+    Transport transport(serial);
+    MidiInterface midi((Transport&)transport);
+
+    Buffer buffer;
+
+    static const byte header[] = { 0x41, 0x12 };
+    static const byte data[] = { 0x80, 1, 2, 3, 4, 5, 0xff, 0x7f, 0xc0 };
+    byte encoded[11];
+    const unsigned encodedLength = midi::encodeSysEx(data, encoded, 9, false);
+    EXPECT_EQ(encodedLength, 11u);
+
+    midi.begin();
+    midi.sendEncodedSysEx(header, 2, data, 9);
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 15);
+    buffer.resize(15);
+    serial.mTxBuffer.read(&buffer[0], 15);
+    Buffer expected = { 0xf0, 0x41, 0x12 };
+    expected.insert(expected.end(), encoded, encoded + 11);
+    expected.push_back(0xf7);
+    EXPECT_THAT(buffer, ElementsAreArray(expected));
+
+    // Flipped header bits and checksum
+    midi::encodeSysEx(data, encoded, 9, true);
+    byte sum = 0;
+    for (unsigned i = 0; i < 11; ++i)
+        sum = byte(sum + encoded[i]);
+
+    midi.sendEncodedSysEx(header, 2, data, 9, true, true);
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 16);
+    buffer.resize(16);
+    serial.mTxBuffer.read(&buffer[0], 16);
+    expected = { 0xf0, 0x41, 0x12 };
+    expected.insert(expected.end(), encoded, encoded + 11);
+    expected.push_back(byte((128 - (sum & 0x7f)) & 0x7f));
+    expected.push_back(0xf7);
+    EXPECT_THAT(buffer, ElementsAreArray(expected));
+    EXPECT_EQ((sum + buffer[14]) % 128, 0);
+}
+
 TEST(MidiOutput, sendTimeCodeQuarterFrame)
 {
     SerialMock serial;
@@ -881,4 +978,763 @@ TEST(MidiOutput, runningStatusCancellation)
     }));
 }
 
+// --
+
+TEST(MidiOutput, sendMessageView)
+{
+    typedef midi::Message<8> Message;
+    SerialMock serial;
+    Transport transport(serial);
+    MidiInterface midi((Transport&)transport);
+
+    Buffer buffer;
+    buffer.resize(11);
+
+    Message message;
+    message.type    = midi::NoteOn;
+    message.channel = 2;
+    message.data1   = 12;
+    message.data2   = 34;
+
+    midi.begin();
+    midi.send(midi::MessageView(message));
+    message.type  = midi::SongPosition;
+    message.data1 = 0x01;
+    message.data2 = 0x02;
+    midi.send(midi::MessageView(message));
+    message.type  = midi::SystemExclusive;
+    message.data1 = 4;
+    message.data2 = 0;
+    const byte sysex[4] = { 0xf0, 5, 6, 0xf7 };
+    memcpy(message.sysexArray, sysex, 4);
+    midi.send(midi::MessageView(message));
+    message.type = midi::Clock;
+    midi.send(midi::MessageView(message));
+
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 11);
+    serial.mTxBuffer.read(&buffer[0], 11);
+    EXPECT_THAT(buffer, ElementsAreArray({
+        0x91, 12, 34, 0xf2, 0x01, 0x02, 0xf0, 5, 6, 0xf7, 0xf8
+    }));
+}
+
+TEST(MidiOutput, sendPacked)
+{
+    SerialMock serial;
+    Transport transport(serial);
+    MidiInterface midi((Transport&)transport);
+
+    Buffer buffer;
+    buffer.resize(6);
+
+    midi.begin();
+    midi.send(midi::PackedMessage(midi::ControlChange, 4, 7, 100));
+    midi.send(midi::PackedMessage());                               // Invalid
+    midi.send(midi::PackedMessage(midi::TimeCodeQuarterFrame, 0, 0x12, 0));
+    midi.send(midi::PackedMessage(midi::Start, 0, 0, 0));
+
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 6);
+    serial.mTxBuffer.read(&buffer[0], 6);
+    EXPECT_THAT(buffer, ElementsAreArray({ 0xb3, 7, 100, 0xf1, 0x12, 0xfa }));
+}
+
+// --
+
+struct CachedSettings : midi::DefaultSettings
+{
+    static const bool UseOutputCache = true;
+};
+
+TEST(MidiOutput, outputCache)
+{
+    typedef midi::MidiInterface<Transport, CachedSettings> CachedMidiInterface;
+
+    SerialMock serial;
+    Transport transport(serial);
+    CachedMidiInterface midi((Transport&)transport);
+
+    Buffer buffer;
+
+    midi.begin();
+    midi.sendControlChange(midi::ChannelVolume, 100, 1);
+    midi.sendControlChange(midi::ChannelVolume, 100, 1);    // Skipped
+    midi.sendControlChange(midi::ChannelVolume, 100, 2);
+    midi.sendProgramChange(5, 1);
+    midi.sendProgramChange(5, 1);                           // Skipped
+    midi.sendPitchBend(1000, 1);
+    midi.sendPitchBend(1000, 1);                            // Skipped
+    midi.sendAfterTouch(64, 1);
+    midi.sendAfterTouch(64, 1);                             // Skipped
+    midi.sendControlChange(midi::AllNotesOff, 0, 1);
+    midi.sendControlChange(midi::AllNotesOff, 0, 1);        // Channel Mode messages are always sent
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 19);
+    buffer.resize(19);
+    serial.mTxBuffer.read(&buffer[0], 19);
+    EXPECT_THAT(buffer, ElementsAreArray({
+        0xb0, 7, 100,
+        0xb1, 7, 100,
+        0xc0, 5,
+        0xe0, 0x68, 0x47,
+        0xd0, 64,
+        0xb0, 123, 0,
+        0xb0, 123, 0,
+    }));
+
+    // Data Entry is sent again for another parameter
+    midi.beginRpn(midi::RPN::PitchBendSensitivity, 1);
+    midi.sendRpnValue(2, 0, 1);
+    midi.sendRpnValue(2, 0, 1);                             // Skipped
+    midi.beginRpn(midi::RPN::ChannelCoarseTuning, 1);
+    midi.sendRpnValue(2, 0, 1);
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 24);
+    buffer.resize(24);
+    serial.mTxBuffer.read(&buffer[0], 24);
+    EXPECT_THAT(buffer, ElementsAreArray({
+        0xb0, 100, 0, 0xb0, 101, 0,
+        0xb0, 6, 2, 0xb0, 38, 0,
+        0xb0, 100, 2, 0xb0, 101, 0,
+        0xb0, 6, 2, 0xb0, 38, 0,
+    }));
+
+    // Values are sent again once invalidated
+    midi.invalidateOutputCache(2);
+    midi.sendControlChange(midi::ChannelVolume, 100, 1);    // Skipped
+    midi.sendControlChange(midi::ChannelVolume, 100, 2);
+    midi.sendSystemReset();
+    midi.sendProgramChange(5, 1);
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 6);
+    buffer.resize(6);
+    serial.mTxBuffer.read(&buffer[0], 6);
+    EXPECT_THAT(buffer, ElementsAreArray({ 0xb1, 7, 100, 0xff, 0xc0, 5 }));
+
+    // A new bank is only loaded by the next Program Change
+    midi.sendProgramChange(5, 1);                           // Skipped
+    midi.sendControlChange(midi::BankSelect, 1, 1);
+    midi.sendProgramChange(5, 1);
+    midi.sendControlChange(midi::BankSelect, 1, 1);         // Skipped
+    midi.sendProgramChange(5, 1);                           // Skipped
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 5);
+    buffer.resize(5);
+    serial.mTxBuffer.read(&buffer[0], 5);
+    EXPECT_THAT(buffer, ElementsAreArray({ 0xb0, 0, 1, 0xc0, 5 }));
+
+    // Messages sent whole go through the cache too
+    CachedMidiInterface::MidiMessage message;
+    message.type    = midi::ControlChange;
+    message.channel = 1;
+    message.data1   = midi::ChannelVolume;
+    message.data2   = 90;
+    message.length  = 3;
+    message.valid   = true;
+    midi.send(message);
+    midi.send(message);                                     // Skipped
+    midi.sendControlChange(midi::ChannelVolume, 90, 1);     // Skipped
+    message.type    = midi::SystemReset;
+    message.channel = 0;
+    message.length  = 1;
+    midi.send(message);
+    midi.sendControlChange(midi::ChannelVolume, 90, 1);
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 7);
+    buffer.resize(7);
+    serial.mTxBuffer.read(&buffer[0], 7);
+    EXPECT_THAT(buffer, ElementsAreArray({ 0xb0, 7, 90, 0xff, 0xb0, 7, 90 }));
+}
+
+TEST(MidiOutput, syncTo)
+{
+    typedef midi::MidiInterface<Transport, CachedSettings> CachedMidiInterface;
+
+    SerialMock serial;
+    Transport transport(serial);
+    CachedMidiInterface midi((Transport&)transport);
+
+    Buffer buffer;
+
+    midi::ChannelState state;
+    state.controls[midi::BankSelect]    = 1;
+    state.controls[midi::BankSelectLSB] = 2;
+    state.controls[midi::ChannelVolume] = 100;
+    state.controls[midi::DataEntryMSB]  = 3;
+    state.controls[midi::DataEntryLSB]  = 4;
+    state.controls[midi::RPNLSB]        = 5;    // Not held, never sent
+    state.program   = 5;
+    state.pressure  = 64;
+    state.pitchBend = 8192;
+
+    midi.begin();
+    midi.beginRpn(midi::RPN::PitchBendSensitivity, 1);
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 6);
+    serial.mTxBuffer.clear();
+
+    // Bank Select first, then the program, controllers in order (Data Entry
+    // MSB before LSB), pressure and pitch bend
+    midi.syncTo(state, 1);
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 22);
+    buffer.resize(22);
+    serial.mTxBuffer.read(&buffer[0], 22);
+    EXPECT_THAT(buffer, ElementsAreArray({
+        0xb0, 0, 1,
+        0xb0, 32, 2,
+        0xc0, 5,
+        0xb0, 6, 3,
+        0xb0, 7, 100,
+        0xb0, 38, 4,
+        0xd0, 64,
+        0xe0, 0, 64,
+    }));
+
+    // Only changed values are sent
+    midi.syncTo(state, 1);
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 0);
+    state.controls[midi::ChannelVolume] = 90;
+    midi.syncTo(state, 1);
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 3);
+    buffer.resize(3);
+    serial.mTxBuffer.read(&buffer[0], 3);
+    EXPECT_THAT(buffer, ElementsAreArray({ 0xb0, 7, 90 }));
+
+    // The same program is sent again to select the new bank
+    state.controls[midi::BankSelectLSB] = 3;
+    midi.syncTo(state, 1);
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 5);
+    buffer.resize(5);
+    serial.mTxBuffer.read(&buffer[0], 5);
+    EXPECT_THAT(buffer, ElementsAreArray({ 0xb0, 32, 3, 0xc0, 5 }));
+
+    // Data Entry is sent again once another parameter is selected
+    midi.beginRpn(midi::RPN::ChannelCoarseTuning, 1);
+    serial.mTxBuffer.clear();
+    midi.syncTo(state, 1);
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 6);
+    buffer.resize(6);
+    serial.mTxBuffer.read(&buffer[0], 6);
+    EXPECT_THAT(buffer, ElementsAreArray({ 0xb0, 6, 3, 0xb0, 38, 4 }));
+
+    // Unset values and other channels are left as they are
+    midi::ChannelState states[16];
+    states[1].program = 7;
+    midi.syncTo(states);
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 2);
+    buffer.resize(2);
+    serial.mTxBuffer.read(&buffer[0], 2);
+    EXPECT_THAT(buffer, ElementsAreArray({ 0xc1, 7 }));
+}
+
+TEST(MidiOutput, syncToWithoutCache)
+{
+    SerialMock serial;
+    Transport transport(serial);
+    MidiInterface midi((Transport&)transport);
+
+    Buffer buffer;
+
+    midi::ChannelState state;
+    state.controls[midi::BankSelect]    = 1;
+    state.controls[midi::ChannelVolume] = 100;
+    state.program = 5;
+
+    // Without the output cache, all the values set are sent every time
+    midi.begin();
+    midi.syncTo(state, 3);
+    midi.syncTo(state, 3);
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 16);
+    buffer.resize(16);
+    serial.mTxBuffer.read(&buffer[0], 16);
+    EXPECT_THAT(buffer, ElementsAreArray({
+        0xb2, 0, 1, 0xc2, 5, 0xb2, 7, 100,
+        0xb2, 0, 1, 0xc2, 5, 0xb2, 7, 100,
+    }));
+
+    // Invalid channels are ignored
+    midi.syncTo(state, MIDI_CHANNEL_OMNI);
+    midi.syncTo(state, MIDI_CHANNEL_OFF);
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 0);
+}
+
+
+struct PacedSettings : midi::DefaultSettings
+{
+    static const bool UsePacedSysEx = true;
+};
+
+TEST(MidiOutput, sendPacedSysEx)
+{
+    typedef midi::MidiInterface<Transport, PacedSettings, ManualPlatform> PacedMidiInterface;
+
+    SerialMock serial;
+    Transport transport(serial);
+    PacedMidiInterface midi((Transport&)transport);
+
+    Buffer buffer;
+
+    static const byte sysex[] = { 1, 2, 3, 4, 5 };
+
+    midi.begin();
+    midi.turnThruOff();
+
+    // First chunk is sent right away
+    midi.sendPacedSysEx(5, sysex, 3, 10);
+    EXPECT_TRUE(midi.isSendingPacedSysEx());
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 3);
+
+    // Other messages are rejected, real-time ones go through
+    midi.sendNoteOn(12, 34, 1);
+    EXPECT_FALSE(midi.isSendAccepted());
+    midi.sendClock();
+    EXPECT_TRUE(midi.isSendAccepted());
+
+    // So is another frame until this one ends
+    midi.sendPacedSysEx(5, sysex, 3, 10);
+    EXPECT_FALSE(midi.isSendAccepted());
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 4);
+    ManualPlatform::sNow += 9;
+    midi.update();
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 4);
+
+    // Next chunks are sent when reading, or by update()
+    ManualPlatform::sNow += 1;
+    midi.read();
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 7);
+    ManualPlatform::sNow += 10;
+    midi.pump();
+    EXPECT_TRUE(midi.isSendingPacedSysEx()); // pump() only drains the queue
+    midi.update();
+    EXPECT_FALSE(midi.isSendingPacedSysEx());
+
+    midi.sendNoteOn(12, 34, 1);
+    EXPECT_TRUE(midi.isSendAccepted());
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 11);
+    buffer.resize(11);
+    serial.mTxBuffer.read(&buffer[0], 11);
+    EXPECT_THAT(buffer, ElementsAreArray({ 0xf0, 1, 2, 0xf8, 3, 4, 5, 0xf7, 0x90, 12, 34 }));
+}
+
+struct ScheduledSettings : midi::DefaultSettings
+{
+    static const unsigned ScheduleMaxSize = 4;
+};
+
+TEST(MidiOutput, sendAt)
+{
+    typedef midi::MidiInterface<Transport, ScheduledSettings, ManualPlatform> ScheduledMidiInterface;
+
+    SerialMock serial;
+    Transport transport(serial);
+    ScheduledMidiInterface midi((Transport&)transport);
+
+    Buffer buffer;
+
+    ManualPlatform::sNow = 1000;
+    midi.begin();
+    midi.turnThruOff();
+
+    EXPECT_TRUE(midi.sendAt(1020, midi::PackedMessage(midi::NoteOff, 1, 60, 0)));
+    EXPECT_TRUE(midi.sendAt(1010, midi::PackedMessage(midi::NoteOn,  1, 62, 100)));
+    EXPECT_TRUE(midi.sendAt(1020, midi::PackedMessage(midi::NoteOn,  1, 64, 100)));
+    EXPECT_TRUE(midi.sendAt(1000, midi::PackedMessage(midi::Clock,   0, 0, 0)));
+    EXPECT_FALSE(midi.sendAt(1030, midi::PackedMessage(midi::Stop,   0, 0, 0)));
+    EXPECT_EQ(midi.getScheduledCount(), 4u);
+
+    midi.update();
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 1);
+    ManualPlatform::sNow = 1015;
+    midi.read();
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 4);
+    ManualPlatform::sNow = 1020;
+    midi.pump(); // Only drains the transmit queue
+    EXPECT_EQ(midi.getScheduledCount(), 2u);
+    midi.update();
+    EXPECT_EQ(midi.getScheduledCount(), 0u);
+
+    // Messages scheduled for the same time keep their order
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 10);
+    buffer.resize(10);
+    serial.mTxBuffer.read(&buffer[0], 10);
+    EXPECT_THAT(buffer, ElementsAreArray({ 0xf8, 0x90, 62, 100, 0x80, 60, 0, 0x90, 64, 100 }));
+
+    // Times wrap around
+    ManualPlatform::sNow = ~0ul - 15;
+    midi.sendAt(0x10, midi::PackedMessage(midi::Stop, 0, 0, 0));
+    midi.sendAt(~0ul - 7, midi::PackedMessage(midi::Start, 0, 0, 0));
+    midi.update();
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 0);
+    ManualPlatform::sNow = 0;
+    midi.update();
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 1);
+    midi.clearSchedule();
+    EXPECT_EQ(midi.getScheduledCount(), 0u);
+    ManualPlatform::sNow = 0x10;
+    midi.update();
+    buffer.resize(1);
+    serial.mTxBuffer.read(&buffer[0], 1);
+    EXPECT_THAT(buffer, ElementsAreArray({ 0xfa }));
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 0);
+}
+
+struct QueuedSettings : midi::DefaultSettings
+{
+    static const bool UseRunningStatus = true;
+    static const unsigned TxQueueSize = 16;
+};
+
+TEST(MidiOutput, sendQueued)
+{
+    typedef midi::MidiInterface<Transport, QueuedSettings> QueuedMidiInterface;
+
+    SerialMock serial;
+    Transport transport(serial);
+    QueuedMidiInterface midi((Transport&)transport);
+
+    Buffer buffer;
+    buffer.resize(9);
+
+    static const byte sysex[] = { 1, 2, 3, 4 };
+
+    midi.begin();
+    EXPECT_EQ(midi.getTxQueueAvailable(), 15u);
+
+    midi.sendNoteOn(12, 34, 1);
+    EXPECT_TRUE(midi.isSendAccepted());
+    midi.sendSysEx(4, sysex);
+    EXPECT_TRUE(midi.isSendAccepted());
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 0);
+    EXPECT_EQ(midi.getTxQueueAvailable(), 2u);
+
+    // No room left, the message is dropped
+    midi.sendNoteOn(20, 100, 1);
+    EXPECT_FALSE(midi.isSendAccepted());
+
+    // Messages can be pumped over several calls
+    EXPECT_EQ(midi.pump(4), 4u);
+    EXPECT_EQ(midi.pump(), 5u);
+    EXPECT_EQ(midi.pump(), 0u);
+    EXPECT_EQ(midi.getTxQueueAvailable(), 15u);
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 9);
+    serial.mTxBuffer.read(&buffer[0], 9);
+    EXPECT_THAT(buffer, ElementsAreArray({ 0x90, 12, 34, 0xf0, 1, 2, 3, 4, 0xf7 }));
+
+    // Running status is not affected by the dropped message
+    midi.sendNoteOn(12, 0, 1);
+    midi.sendNoteOn(13, 0, 1);
+    EXPECT_TRUE(midi.isSendAccepted());
+    EXPECT_EQ(midi.pump(), 5u);
+    buffer.resize(5);
+    serial.mTxBuffer.read(&buffer[0], 5);
+    EXPECT_THAT(buffer, ElementsAreArray({ 0x90, 12, 0, 13, 0 }));
+
+    // Too large for the whole queue
+    static const byte largeSysEx[16] = { 0 };
+    midi.sendSysEx(16, largeSysEx);
+    EXPECT_FALSE(midi.isSendAccepted());
+    EXPECT_EQ(midi.pump(), 0u);
+}
+
+struct QueuedScheduledSettings : QueuedSettings
+{
+    static const unsigned ScheduleMaxSize = 4;
+};
+
+TEST(MidiOutput, sendAtQueueFull)
+{
+    typedef midi::MidiInterface<Transport, QueuedScheduledSettings, ManualPlatform> QueuedMidiInterface;
+
+    SerialMock serial;
+    Transport transport(serial);
+    QueuedMidiInterface midi((Transport&)transport);
+
+    Buffer buffer;
+
+    static const byte sysex[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+
+    ManualPlatform::sNow = 1000;
+    midi.begin();
+    midi.turnThruOff();
+
+    midi.sendSysEx(9, sysex);
+    EXPECT_EQ(midi.getTxQueueAvailable(), 2u);
+
+    // A due message that does not fit stays scheduled
+    EXPECT_TRUE(midi.sendAt(1000, midi::PackedMessage(midi::NoteOn, 1, 60, 100)));
+    EXPECT_TRUE(midi.sendAt(1000, midi::PackedMessage(midi::NoteOff, 1, 60, 0)));
+    midi.update();
+    EXPECT_FALSE(midi.isSendAccepted());
+    EXPECT_EQ(midi.getScheduledCount(), 2u);
+
+    EXPECT_EQ(midi.pump(), 11u);
+    serial.mTxBuffer.clear();
+    midi.update();
+    EXPECT_TRUE(midi.isSendAccepted());
+    EXPECT_EQ(midi.getScheduledCount(), 0u);
+    EXPECT_EQ(midi.pump(), 6u);
+    buffer.resize(6);
+    serial.mTxBuffer.read(&buffer[0], 6);
+    EXPECT_THAT(buffer, ElementsAreArray({ 0x90, 60, 100, 0x80, 60, 0 }));
+}
+
+struct QueuedPacedSettings : QueuedSettings
+{
+    static const bool UsePacedSysEx = true;
+};
+
+TEST(MidiOutput, sendOversizedSysExQueued)
+{
+    typedef midi::MidiInterface<Transport, QueuedPacedSettings, ManualPlatform> QueuedMidiInterface;
+
+    SerialMock serial;
+    Transport transport(serial);
+    QueuedMidiInterface midi((Transport&)transport);
+
+    Buffer buffer;
+
+    static const byte sysex[14] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14 };
+
+    // Longer than the queue can hold: rejected every time, even when empty
+    midi.begin();
+    midi.sendSysEx(14, sysex);
+    EXPECT_FALSE(midi.isSendAccepted());
+    EXPECT_EQ(midi.pump(), 0u);
+    midi.sendSysEx(14, sysex);
+    EXPECT_FALSE(midi.isSendAccepted());
+    EXPECT_EQ(midi.getTxQueueAvailable(), 15u);
+
+    // Sent in chunks queued one at a time
+    midi.sendPacedSysEx(14, sysex, 8, 0);
+    EXPECT_TRUE(midi.isSendingPacedSysEx());
+    midi.update();                                  // No room for the next chunk yet
+    EXPECT_TRUE(midi.isSendingPacedSysEx());
+    EXPECT_EQ(midi.pump(), 8u);
+    midi.update();
+    EXPECT_FALSE(midi.isSendingPacedSysEx());
+    EXPECT_EQ(midi.pump(), 8u);
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 16);
+    buffer.resize(16);
+    serial.mTxBuffer.read(&buffer[0], 16);
+    EXPECT_THAT(buffer, ElementsAreArray({
+        0xf0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 0xf7
+    }));
+}
+
+struct RealTimeSettings : QueuedSettings
+{
+    static const unsigned TxQueueSize = 32;
+    static const unsigned RealTimeQueueSize = 3;
+};
+
+TEST(MidiOutput, sendRealTimeFirst)
+{
+    typedef midi::MidiInterface<Transport, RealTimeSettings> RtMidiInterface;
+
+    SerialMock serial;
+    Transport transport(serial);
+    RtMidiInterface midi((Transport&)transport);
+
+    Buffer buffer;
+
+    static const byte sysex[] = { 1, 2, 3, 4 };
+
+    midi.begin();
+    midi.sendSysEx(4, sysex);
+    midi.sendStart();
+    EXPECT_EQ(midi.pump(3), 3u);
+
+    // Injected in the middle of the SysEx
+    midi.sendClock();
+    midi.sendClock();
+    EXPECT_TRUE(midi.isSendAccepted());
+    midi.sendClock();
+    EXPECT_FALSE(midi.isSendAccepted());
+    EXPECT_EQ(midi.pump(), 6u);
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 9);
+    buffer.resize(9);
+    serial.mTxBuffer.read(&buffer[0], 9);
+    EXPECT_THAT(buffer, ElementsAreArray({ 0xfa, 0xf0, 1, 0xf8, 0xf8, 2, 3, 4, 0xf7 }));
+}
+
+TEST(MidiOutput, thruIsQueued)
+{
+    typedef midi::MidiInterface<Transport, QueuedSettings> QueuedMidiInterface;
+
+    SerialMock serial;
+    Transport transport(serial);
+    QueuedMidiInterface midi((Transport&)transport);
+
+    midi.begin(MIDI_CHANNEL_OMNI);
+
+    static const byte rxData[] = { 0x9b, 12, 34 };
+    serial.mRxBuffer.write(rxData, 3);
+    EXPECT_EQ(midi.read(), false);
+    EXPECT_EQ(midi.read(), false);
+    EXPECT_EQ(midi.read(), true);
+
+    // Reading does not wait for the output
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 0);
+    EXPECT_EQ(midi.pump(), 3u);
+    EXPECT_EQ(serial.mTxBuffer.getLength(), 3);
+}
+
+// --
+
+struct PacketTransport
+{
+    static const bool thruActivated = false;
+
+    void begin() {}
+    bool beginTransmission(midi::MidiType inType, unsigned inSizeHint)
+    {
+        mTypes.push_back(inType);
+        mSizeHints.push_back(inSizeHint);
+        mPackets.push_back(Buffer());
+        return true;
+    }
+    void write(byte inByte)     { mPackets.back().push_back(inByte); }
+    void endTransmission()      { ++mEndCount; }
+    byte read()                 { return 0; }
+    unsigned available()        { return 0; }
+
+    std::vector<midi::MidiType> mTypes;
+    std::vector<unsigned> mSizeHints;
+    std::vector<Buffer> mPackets;
+    unsigned mEndCount = 0;
+};
+
+TEST(MidiOutput, sendBatch)
+{
+    PacketTransport transport;
+    midi::MidiInterface<PacketTransport> midi(transport);
+
+    midi.begin();
+    midi.sendNoteOn(60, 100, 1);
+    ASSERT_EQ(transport.mPackets.size(), 1u);
+    EXPECT_EQ(transport.mSizeHints[0], 3u);
+
+    midi.beginBatch(9);
+    midi.sendNoteOn(60, 100, 2);
+    midi.sendNoteOn(64, 100, 2);
+    midi.sendNoteOn(67, 100, 2);
+    EXPECT_EQ(transport.mEndCount, 1u);
+    midi.commitBatch();
+
+    ASSERT_EQ(transport.mPackets.size(), 2u);
+    EXPECT_EQ(transport.mEndCount, 2u);
+    EXPECT_EQ(transport.mTypes[1], midi::NoteOn);
+    EXPECT_EQ(transport.mSizeHints[1], 9u);
+    EXPECT_THAT(transport.mPackets[1], ElementsAreArray({ 0x91, 60, 100, 0x91, 64, 100, 0x91, 67, 100 }));
+
+    // Empty batch
+    midi.beginBatch().commitBatch();
+    EXPECT_EQ(transport.mPackets.size(), 2u);
+    EXPECT_EQ(transport.mEndCount, 2u);
+}
+
+TEST(MidiOutput, sendBatchQueued)
+{
+    PacketTransport transport;
+    midi::MidiInterface<PacketTransport, QueuedSettings> midi(transport);
+
+    midi.begin();
+    midi.beginBatch();
+    midi.sendControlChange(0, 1, 1);
+    midi.sendProgramChange(12, 1);
+    EXPECT_EQ(midi.getTxQueueAvailable(), 15u - 2 - 5);
+    EXPECT_EQ(midi.pump(), 0u); // Not committed yet
+    midi.commitBatch();
+
+    EXPECT_EQ(midi.pump(), 5u);
+    ASSERT_EQ(transport.mPackets.size(), 1u);
+    EXPECT_EQ(transport.mEndCount, 1u);
+    EXPECT_EQ(transport.mTypes[0], midi::ControlChange);
+    EXPECT_EQ(transport.mSizeHints[0], 5u);
+    EXPECT_THAT(transport.mPackets[0], ElementsAreArray({ 0xb0, 0, 1, 0xc0, 12 }));
+}
+
+TEST(MidiOutput, sendRealTimeBetweenPackets)
+{
+    const bool transportIsByteStream = midi::TransportAdapter::IsByteStream<Transport>::value;
+    const bool packetIsByteStream    = midi::TransportAdapter::IsByteStream<PacketTransport>::value;
+    EXPECT_TRUE(transportIsByteStream);
+    EXPECT_FALSE(packetIsByteStream);
+
+    PacketTransport transport;
+    midi::MidiInterface<PacketTransport, RealTimeSettings> midi(transport);
+
+    static const byte sysex[] = { 1, 2, 3, 4 };
+
+    midi.begin();
+    midi.sendSysEx(4, sysex);
+    EXPECT_EQ(midi.pump(3), 3u);
+
+    // Packets are not split: the clock waits for the end of the SysEx
+    midi.sendClock();
+    EXPECT_EQ(midi.pump(), 4u);
+    ASSERT_EQ(transport.mPackets.size(), 2u);
+    EXPECT_EQ(transport.mEndCount, 2u);
+    EXPECT_THAT(transport.mPackets[0], ElementsAreArray({ 0xf0, 1, 2, 3, 4, 0xf7 }));
+    EXPECT_EQ(transport.mTypes[1], midi::Clock);
+    EXPECT_THAT(transport.mPackets[1], ElementsAreArray({ 0xf8 }));
+}
+
+// --
+
+struct BulkTransport : PacketTransport
+{
+    using PacketTransport::write;
+    void write(const byte* inData, size_t inLength)
+    {
+        mWrites.push_back(Buffer(inData, inData + inLength));
+    }
+
+    std::vector<Buffer> mWrites;
+};
+
+TEST(MidiOutput, bulkWrite)
+{
+    const bool serialHasBulkWrite    = midi::TransportAdapter::HasBulkWrite<SerialMock>::value;
+    const bool transportHasBulkWrite = midi::TransportAdapter::HasBulkWrite<Transport>::value;
+    const bool mockHasBulkWrite      = midi::TransportAdapter::HasBulkWrite<BulkTransport>::value;
+    EXPECT_FALSE(serialHasBulkWrite);
+    EXPECT_TRUE(transportHasBulkWrite); // SerialMIDI forwards to the port, or loops
+    EXPECT_TRUE(mockHasBulkWrite);
+
+    BulkTransport transport;
+    midi::MidiInterface<BulkTransport> midi(transport);
+
+    static const byte sysex[] = { 1, 2, 3, 4, 5 };
+
+    midi.begin();
+    midi.sendNoteOn(60, 100, 1);
+    midi.sendSysEx(5, sysex);
+
+    EXPECT_TRUE(transport.mPackets[0].empty()); // No single byte writes
+    EXPECT_TRUE(transport.mPackets[1].empty());
+    ASSERT_EQ(transport.mWrites.size(), 4u);
+    EXPECT_THAT(transport.mWrites[0], ElementsAreArray({ 0x90, 60, 100 }));
+    EXPECT_THAT(transport.mWrites[1], ElementsAreArray({ 0xf0 }));
+    EXPECT_THAT(transport.mWrites[2], ElementsAreArray({ 1, 2, 3, 4, 5 }));
+    EXPECT_THAT(transport.mWrites[3], ElementsAreArray({ 0xf7 }));
+}
+
+TEST(MidiOutput, bulkWriteQueued)
+{
+    BulkTransport transport;
+    midi::MidiInterface<BulkTransport, QueuedSettings> midi(transport);
+
+    static const byte sysex[] = { 1, 2, 3, 4, 5, 6, 7 };
+
+    midi.begin();
+    midi.sendNoteOn(60, 100, 1);
+    midi.sendNoteOn(62, 100, 1);
+    EXPECT_EQ(midi.pump(), 5u);
+    ASSERT_EQ(transport.mWrites.size(), 2u);
+    EXPECT_THAT(transport.mWrites[0], ElementsAreArray({ 0x90, 60, 100 }));
+    EXPECT_THAT(transport.mWrites[1], ElementsAreArray({ 62, 100 }));
+
+    // The message wraps around the end of the queue
+    midi.sendSysEx(7, sysex);
+    EXPECT_EQ(midi.pump(), 9u);
+    ASSERT_EQ(transport.mWrites.size(), 4u);
+    EXPECT_EQ(transport.mWrites[2].size() + transport.mWrites[3].size(), 9u);
+    EXPECT_EQ(transport.mWrites[2][0], 0xf0);
+    EXPECT_EQ(transport.mWrites[3].back(), 0xf7);
+}
+
 END_UNNAMED_NAMESPACE
@@ -0,0 +1,141 @@
+#include "unit-tests.h"
+#include <src/MIDI.h>
+
+BEGIN_MIDI_NAMESPACE
+
+END_MIDI_NAMESPACE
+
+// -----------------------------------------------------------------------------
+
+BEGIN_UNNAMED_NAMESPACE
+
+using namespace testing;
+USING_NAMESPACE_UNIT_TESTS
+
+typedef midi::Parser<16> Parser;
+
+TEST(MidiParser, parse)
+{
+    Parser parser;
+    Parser::MidiMessage message;
+
+    EXPECT_EQ(parser.parse(0x9b, message), Parser::Pending);
+    EXPECT_EQ(parser.parse(12,   message), Parser::Pending);
+    EXPECT_EQ(parser.parse(34,   message), Parser::Complete);
+    EXPECT_EQ(message.type,    midi::NoteOn);
+    EXPECT_EQ(message.channel, 12);
+    EXPECT_EQ(message.data1,   12);
+    EXPECT_EQ(message.data2,   34);
+
+    // Running status
+    EXPECT_EQ(parser.parse(56, message), Parser::Pending);
+    EXPECT_EQ(parser.parse(78, message), Parser::Complete);
+    EXPECT_EQ(message.type,  midi::NoteOn);
+    EXPECT_EQ(message.data1, 56);
+    EXPECT_EQ(message.data2, 78);
+
+    // Unexpected EOX
+    EXPECT_EQ(parser.parse(12,   message), Parser::Pending);
+    EXPECT_EQ(parser.parse(0xf7, message), Parser::Error);
+    EXPECT_EQ(parser.parse(12,   message), Parser::Error);
+}
+
+TEST(MidiParser, messages)
+{
+    static const unsigned size = 15;
+    static const byte data[size] = {
+        0x90, 42, 0xf8, 127,    // Interleaved Clock
+        0xf4,                   // Undefined, skipped
+        0xb3, 7, 100, 8, 101,   // Running status
+        0xf0, 1, 2, 0xf7,
+        0xc0                    // Incomplete
+    };
+
+    std::vector<midi::MidiType> types;
+    std::vector<byte> values;
+    for (const auto& message : midi::messages(data, size))
+    {
+        types.push_back(message.type);
+        values.push_back(message.type == midi::SystemExclusive
+                         ? byte(message.getSysExSize())
+                         : message.data2);
+    }
+
+    ASSERT_EQ(types.size(), 5u);
+    EXPECT_EQ(types[0], midi::Clock);
+    EXPECT_EQ(types[1], midi::NoteOn);
+    EXPECT_EQ(values[1], 127);
+    EXPECT_EQ(types[2], midi::ControlChange);
+    EXPECT_EQ(values[2], 100);
+    EXPECT_EQ(types[3], midi::ControlChange);
+    EXPECT_EQ(values[3], 101);
+    EXPECT_EQ(types[4], midi::SystemExclusive);
+    EXPECT_EQ(values[4], 4);
+
+    EXPECT_TRUE(midi::messages(data, 0).begin() == midi::messages(data, 0).end());
+}
+
+TEST(MidiParser, messagesSplitSysEx)
+{
+    static const unsigned size = 10;
+    static const byte data[size] = { 0xf0, 1, 2, 3, 4, 5, 6, 7, 8, 0xf7 };
+
+    std::vector<std::vector<byte>> chunks;
+    for (const auto& message : midi::messages<4>(data, size))
+    {
+        EXPECT_EQ(message.type, midi::SystemExclusive);
+        chunks.push_back(std::vector<byte>(message.sysexArray,
+                                           message.sysexArray + message.getSysExSize()));
+    }
+
+    ASSERT_EQ(chunks.size(), 4u);
+    EXPECT_THAT(chunks[0], ElementsAreArray({ 0xf0, 1, 2, 0xf0 }));
+    EXPECT_THAT(chunks[1], ElementsAreArray({ 0xf7, 3, 4, 0xf0 }));
+    EXPECT_THAT(chunks[2], ElementsAreArray({ 0xf7, 5, 6, 0xf0 }));
+    EXPECT_THAT(chunks[3], ElementsAreArray({ 0xf7, 7, 8, 0xf7 }));
+}
+
+TEST(MidiParser, independentIterators)
+{
+    static const byte data1[] = { 0x90, 1, 2, 0x91, 3, 4 };
+    static const byte data2[] = { 0xb0, 5, 6 };
+
+    auto range1 = midi::messages(data1, sizeof(data1));
+    auto range2 = midi::messages(data2, sizeof(data2));
+    auto it1 = range1.begin();
+    auto it2 = range2.begin();
+
+    EXPECT_EQ(it1->type, midi::NoteOn);
+    EXPECT_EQ(it2->type, midi::ControlChange);
+    ++it1;
+    EXPECT_EQ(it1->channel, 2);
+    EXPECT_EQ(it2->data2, 6);
+    ++it1;
+    ++it2;
+    EXPECT_TRUE(it1 == range1.end());
+    EXPECT_TRUE(it2 == range2.end());
+}
+
+TEST(MidiParser, indexTypeFitsSysExMaxSize)
+{
+    EXPECT_TRUE((std::is_same<midi::SizeType<128>::type,  uint8_t>::value));
+    EXPECT_TRUE((std::is_same<midi::SizeType<255>::type,  uint8_t>::value));
+    EXPECT_TRUE((std::is_same<midi::SizeType<256>::type,  uint16_t>::value));
+    EXPECT_TRUE((std::is_same<midi::SizeType<65536>::type, uint32_t>::value));
+    EXPECT_LE(sizeof(midi::Parser<128>), 6u);
+
+    // SysEx longer than 255 bytes
+    typedef midi::Parser<300> LargeParser;
+    LargeParser parser;
+    LargeParser::MidiMessage message;
+
+    EXPECT_EQ(parser.parse(0xf0, message), LargeParser::Pending);
+    for (unsigned i = 0; i < 290; ++i)
+        EXPECT_EQ(parser.parse(byte(i & 0x7f), message), LargeParser::Pending);
+    EXPECT_EQ(parser.parse(0xf7, message), LargeParser::Complete);
+    EXPECT_EQ(message.getSysExSize(), 292u);
+    EXPECT_EQ(message.length, 292u);
+    EXPECT_EQ(message.sysexArray[290], 289 & 0x7f);
+}
+
+END_UNNAMED_NAMESPACE
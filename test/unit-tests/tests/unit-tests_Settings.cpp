@@ -3,9 +3,21 @@
 BEGIN_MIDI_NAMESPACE
 
 const bool DefaultSettings::UseRunningStatus;
+const bool DefaultSettings::SendNoteOffAsNullVelocityNoteOn;
+const uint16_t DefaultSettings::RunningStatusRefreshPeriod;
+const unsigned DefaultSettings::RunningStatusRefreshCount;
 const bool DefaultSettings::HandleNullVelocityNoteOnAsNoteOff;
 const bool DefaultSettings::Use1ByteParsing;
 const unsigned DefaultSettings::SysExMaxSize;
+const unsigned DefaultSettings::MaxChannelCallbacks;
+const unsigned DefaultSettings::EventBlockMaxSize;
+const unsigned long DefaultSettings::PlatformTicksPerSecond;
+const bool DefaultSettings::UseHandlerProfiler;
+const unsigned DefaultSettings::TxQueueSize;
+const unsigned DefaultSettings::RealTimeQueueSize;
+const bool DefaultSettings::UseOutputCache;
+const bool DefaultSettings::UsePacedSysEx;
+const unsigned DefaultSettings::ScheduleMaxSize;
 
 END_MIDI_NAMESPACE
 
@@ -16,9 +28,22 @@ BEGIN_UNNAMED_NAMESPACE
 TEST(Settings, hasTheRightDefaultValues)
 {
     EXPECT_EQ(midi::DefaultSettings::UseRunningStatus,                   false);
+    EXPECT_EQ(midi::DefaultSettings::SendNoteOffAsNullVelocityNoteOn,    false);
+    EXPECT_EQ(midi::DefaultSettings::RunningStatusRefreshPeriod,         uint16_t(0));
+    EXPECT_EQ(midi::DefaultSettings::RunningStatusRefreshCount,          unsigned(0));
     EXPECT_EQ(midi::DefaultSettings::HandleNullVelocityNoteOnAsNoteOff,  true);
     EXPECT_EQ(midi::DefaultSettings::Use1ByteParsing,                    true);
     EXPECT_EQ(midi::DefaultSettings::SysExMaxSize,                       unsigned(128));
+    EXPECT_EQ(midi::DefaultSettings::MaxChannelCallbacks,                unsigned(0));
+    EXPECT_EQ(midi::DefaultSettings::EventBlockMaxSize,                  unsigned(0));
+    EXPECT_EQ(midi::DefaultSettings::PlatformTicksPerSecond,             1000ul);
+    EXPECT_EQ(midi::DefaultSettings::UseHandlerProfiler,                 false);
+    EXPECT_EQ(midi::DefaultSettings::TxQueueSize,                        unsigned(0));
+    EXPECT_EQ(midi::DefaultSettings::RealTimeQueueSize,                  unsigned(0));
+    EXPECT_EQ(midi::DefaultSettings::UseOutputCache,                     false);
+    EXPECT_EQ(midi::DefaultSettings::UsePacedSysEx,                      false);
+    EXPECT_EQ(midi::DefaultSettings::ScheduleMaxSize,                    unsigned(0));
+    EXPECT_TRUE((std::is_same<midi::DefaultSettings::SysExPool, void>::value));
 }
 
 END_UNNAMED_NAMESPACE